@@ -3,8 +3,7 @@
 #include "feature/core/quads.h"
 #include "util/io.h"
 
-#include <igl/readOBJ.h>
-#include <igl/writeOBJ.h>
+#include "obj_io.h"
 #include <CLI/CLI.hpp>
 
 using namespace Penner;
@@ -28,7 +27,7 @@ int main(int argc, char* argv[])
     Eigen::MatrixXd V, _uv, N;
     Eigen::MatrixXi F, _FT, FN;
     spdlog::info("Using mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, _uv, N, F, _FT, FN);
+    if (!load_obj_mesh(mesh_filename, V, _uv, N, F, _FT, FN)) return 1;
 
     int num_faces = F.rows();
     Eigen::MatrixXd uv(4, 2);
@@ -41,7 +40,7 @@ int main(int argc, char* argv[])
     {
         FT.row(f) << 0, 1, 2, 3;
     }
-    igl::writeOBJ(output_filename, V, F, N, FN, uv, FT);
+    write_obj_mesh(output_filename, V, F, N, FN, uv, FT);
 
     //view_quad_mesh(V, F);
 }
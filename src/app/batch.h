@@ -0,0 +1,193 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Penner {
+
+/**
+ * @brief Outcome of processing a single mesh in a batch
+ */
+struct BatchResult
+{
+    std::string name = "";
+    bool success = false;
+    double time = 0.; // wall time in seconds
+    std::string message = "";
+};
+
+/**
+ * @brief Load mesh names from a manifest file with one name per line.
+ *
+ * Empty lines and lines starting with '#' are skipped, and an optional ".obj" suffix is removed.
+ *
+ * @param manifest_filename: path to the manifest
+ * @return list of mesh names
+ */
+inline std::vector<std::string> load_batch_manifest(const std::string& manifest_filename)
+{
+    std::vector<std::string> names = {};
+    std::ifstream manifest_file(manifest_filename);
+    if (!manifest_file) {
+        spdlog::error("Could not open manifest {}", manifest_filename);
+        return names;
+    }
+
+    std::string line;
+    while (std::getline(manifest_file, line)) {
+        // trim whitespace
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        auto last = line.find_last_not_of(" \t\r");
+        std::string name = line.substr(first, last - first + 1);
+        if (name[0] == '#') continue;
+
+        // remove obj suffix if present
+        std::filesystem::path name_path(name);
+        if (name_path.extension() == ".obj") name = name_path.replace_extension().string();
+        names.push_back(name);
+    }
+
+    return names;
+}
+
+/**
+ * @brief Find the names of all obj meshes in a directory, sorted by name.
+ *
+ * Meshes <name>_opt.obj are skipped if <name>.obj is also present, as they are outputs of a
+ * previous run that wrote to the input directory.
+ *
+ * @param input_dir: directory to search
+ * @return list of mesh names (without obj suffix)
+ */
+inline std::vector<std::string> find_batch_meshes(const std::string& input_dir)
+{
+    std::vector<std::string> names = {};
+    for (const auto& entry : std::filesystem::directory_iterator(input_dir)) {
+        if (!entry.is_regular_file()) continue;
+        if (entry.path().extension() != ".obj") continue;
+        std::string name = entry.path().stem().string();
+        std::string suffix = "_opt";
+        if ((name.size() > suffix.size()) &&
+            (name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)) {
+            std::string input_name = name.substr(0, name.size() - suffix.size()) + ".obj";
+            if (std::filesystem::exists(std::filesystem::path(input_dir) / input_name)) continue;
+        }
+        names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
+
+/**
+ * @brief Compute the number of threads each worker may use without oversubscribing the cores.
+ *
+ * The cores are those available to the process, respecting CPU affinity and cgroup quotas.
+ *
+ * @param num_workers: number of concurrent workers
+ * @return per worker thread budget (at least one)
+ */
+inline int compute_thread_budget(int num_workers)
+{
+    int num_cores = get_num_available_cores();
+    return std::max(num_cores / std::max(num_workers, 1), 1);
+}
+
+/**
+ * @brief Process a list of meshes with a pool of workers.
+ *
+ * Meshes are assigned to workers dynamically so that large meshes do not stall the pool. Any
+ * exception thrown while processing a mesh is caught and recorded, and the remaining meshes
+ * are still processed. If a summary filename is provided, a csv line with the status and
+ * timing of each mesh is appended as soon as it finishes.
+ *
+ * @param names: names of the meshes to process
+ * @param process_mesh: function to process a single mesh by name
+ * @param num_workers: number of concurrent workers
+ * @param summary_filename: (optional) path for the csv summary
+ * @return per mesh results, in the order of the input names
+ */
+inline std::vector<BatchResult> run_batch(
+    const std::vector<std::string>& names,
+    const std::function<void(const std::string&)>& process_mesh,
+    int num_workers,
+    const std::string& summary_filename = "")
+{
+    int num_meshes = names.size();
+    std::vector<BatchResult> results(num_meshes);
+
+    // open summary file with header
+    std::mutex summary_mutex;
+    std::ofstream summary_file;
+    if (!summary_filename.empty()) {
+        summary_file.open(summary_filename);
+        summary_file << "name,status,time,message" << std::endl;
+    }
+
+    // process meshes from a shared queue
+    std::atomic<int> next_mesh(0);
+    auto worker = [&]() {
+        while (true) {
+            int i = next_mesh++;
+            if (i >= num_meshes) break;
+
+            BatchResult& result = results[i];
+            result.name = names[i];
+            auto start = std::chrono::steady_clock::now();
+            try {
+                process_mesh(names[i]);
+                result.success = true;
+            } catch (const std::exception& e) {
+                result.message = e.what();
+            } catch (...) {
+                result.message = "unknown error";
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            result.time = elapsed.count();
+
+            if (result.success) {
+                spdlog::info("Processed {} in {} s", result.name, result.time);
+            } else {
+                spdlog::error("Failed to process {}: {}", result.name, result.message);
+            }
+
+            // record result in summary
+            if (summary_file) {
+                std::string message = result.message;
+                std::replace(message.begin(), message.end(), ',', ';');
+                std::replace(message.begin(), message.end(), '\n', ' ');
+                std::lock_guard<std::mutex> lock(summary_mutex);
+                summary_file << result.name << "," << (result.success ? "success" : "failed")
+                             << "," << result.time << "," << message << std::endl;
+            }
+        }
+    };
+
+    num_workers = std::max(std::min(num_workers, num_meshes), 1);
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    return results;
+}
+
+} // namespace Penner
@@ -0,0 +1,86 @@
+#include "obj_io.h"
+
+#include <igl/Timer.h>
+#include <igl/readOBJ.h>
+#include <igl/writeOBJ.h>
+#include <CLI/CLI.hpp>
+
+#include <filesystem>
+#include <limits>
+
+using namespace Penner;
+
+// time a function over several repeats and return the minimum time in seconds
+template <typename Func>
+double time_function(const Func& func, int num_repeats)
+{
+    igl::Timer timer;
+    double min_time = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < num_repeats; ++i)
+    {
+        timer.start();
+        func();
+        min_time = std::min(min_time, timer.getElapsedTime());
+    }
+    return min_time;
+}
+
+int main(int argc, char* argv[])
+{
+    // Get command line arguments
+    CLI::App app{"Benchmark obj reading and writing against libigl"};
+    std::string mesh_filename = "";
+    std::string output_dir = "./";
+    int num_repeats = 3;
+    int num_threads = 0;
+
+    // IO Parameters
+    app.add_option("--mesh", mesh_filename, "Mesh filepath")->check(CLI::ExistingFile)->required();
+    app.add_option("--output", output_dir, "Output directory for written meshes");
+    app.add_option("--repeats", num_repeats, "Number of timed repeats")->check(CLI::PositiveNumber);
+    app.add_option("--threads", num_threads, "Number of threads (nonpositive for all)");
+    CLI11_PARSE(app, argc, argv);
+
+    spdlog::set_level(spdlog::level::info);
+    std::filesystem::create_directory(output_dir);
+    set_num_threads(num_threads);
+    double file_size = std::filesystem::file_size(mesh_filename) / (1024. * 1024.);
+
+    // time reading
+    Eigen::MatrixXd V_igl, uv_igl, N_igl, V, uv, N;
+    Eigen::MatrixXi F_igl, FT_igl, FN_igl, F, FT, FN;
+    double igl_read_time = time_function([&]() {
+        igl::readOBJ(mesh_filename, V_igl, uv_igl, N_igl, F_igl, FT_igl, FN_igl);
+    }, num_repeats);
+    bool is_loaded = false;
+    double read_time = time_function([&]() {
+        is_loaded = load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN);
+    }, num_repeats);
+    if (!is_loaded) return 1;
+
+    // check the meshes agree, comparing sizes first as Eigen asserts on mismatched sizes
+    auto is_equal = [](const auto& A, const auto& B) {
+        return ((A.rows() == B.rows()) && (A.cols() == B.cols()) && (A == B));
+    };
+    bool is_same = (is_equal(V, V_igl) && is_equal(F, F_igl) && is_equal(uv, uv_igl) && is_equal(N, N_igl));
+    is_same = is_same && ((FT.size() == 0) || is_equal(FT, FT_igl));
+    is_same = is_same && ((FN.size() == 0) || is_equal(FN, FN_igl));
+    if (!is_same) spdlog::warn("Parsed mesh differs from libigl");
+
+    // time writing
+    std::string igl_filename = (std::filesystem::path(output_dir) / "benchmark_igl.obj").string();
+    std::string output_filename = (std::filesystem::path(output_dir) / "benchmark.obj").string();
+    double igl_write_time = time_function([&]() {
+        igl::writeOBJ(igl_filename, V, F, N, FN, uv, FT);
+    }, num_repeats);
+    double write_time = time_function([&]() {
+        write_obj_mesh(output_filename, V, F, N, FN, uv, FT);
+    }, num_repeats);
+
+    spdlog::info("Mesh with {} vertices and {} faces ({:.1f} MB) using {} threads",
+        V.rows(), F.rows(), file_size, get_num_threads());
+    spdlog::info("read:  libigl {:.3f} s ({:.1f} MB/s), parallel {:.3f} s ({:.1f} MB/s), speedup {:.2f}",
+        igl_read_time, file_size / igl_read_time, read_time, file_size / read_time, igl_read_time / read_time);
+    spdlog::info("write: libigl {:.3f} s, parallel {:.3f} s, speedup {:.2f}",
+        igl_write_time, write_time, igl_write_time / write_time);
+}
@@ -0,0 +1,496 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Penner {
+
+// Binary container of named dense arrays
+//
+// The file consists of a fixed size header, a table of section descriptors, and the raw
+// column-major array data, with each array aligned to 64 bytes. Since the data is stored in
+// native layout, a mapped file can be viewed directly with Eigen maps without any parsing.
+//
+// Arrays can instead be compressed with zstd in independent blocks, which are compressed and
+// decompressed in parallel. A compressed array starts with the uncompressed block size, the
+// number of blocks, and the compressed size of each block, followed by the blocks.
+
+constexpr uint32_t BINARY_MAGIC = 0x424e4e50; // "PNNB"
+
+enum class BinaryType : uint32_t {
+    float64 = 0,
+    int32 = 1,
+};
+
+enum class BinaryCompression : uint32_t {
+    none = 0,
+    zstd = 1,
+};
+
+// uncompressed size of compressed blocks
+constexpr uint64_t BINARY_BLOCK_SIZE = uint64_t(1) << 20;
+
+struct BinaryHeader
+{
+    uint32_t magic = BINARY_MAGIC;
+    uint32_t version = 0;
+    uint64_t key = 0;
+    uint64_t num_sections = 0;
+    uint64_t reserved = 0;
+};
+
+struct BinarySection
+{
+    char name[32] = {};
+    BinaryType type = BinaryType::float64;
+    BinaryCompression compression = BinaryCompression::none;
+    int64_t rows = 0;
+    int64_t cols = 0;
+    uint64_t offset = 0;
+};
+
+template <typename T>
+constexpr BinaryType binary_type();
+template <>
+constexpr BinaryType binary_type<double>()
+{
+    return BinaryType::float64;
+}
+template <>
+constexpr BinaryType binary_type<int>()
+{
+    return BinaryType::int32;
+}
+
+inline uint64_t binary_type_size(BinaryType type)
+{
+    return (type == BinaryType::float64) ? sizeof(double) : sizeof(int32_t);
+}
+
+/**
+ * @brief Compute the 64 bit FNV-1a hash of a range of bytes.
+ *
+ * @param data: bytes to hash
+ * @param size: number of bytes
+ * @param hash: (optional) initial hash value to chain hashes
+ * @return hash of the bytes
+ */
+inline uint64_t hash_bytes(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Compute the hash of the contents of a file.
+ *
+ * @param filename: file to hash
+ * @return hash of the file contents, or 0 if the file cannot be read
+ */
+inline uint64_t hash_file(const std::string& filename)
+{
+    std::ifstream input_file(filename, std::ios::binary);
+    if (!input_file) return 0;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    std::vector<char> buffer(1 << 20);
+    while (input_file) {
+        input_file.read(buffer.data(), buffer.size());
+        hash = hash_bytes(buffer.data(), input_file.gcount(), hash);
+    }
+    return hash;
+}
+
+/**
+ * @brief Writer for a binary container.
+ *
+ * Arrays are registered by name and streamed to the file in a single pass when written, with
+ * the header and section table filled in last.
+ */
+class BinaryWriter
+{
+public:
+    /**
+     * @brief Construct a writer for a container.
+     *
+     * @param version: version of the stored data
+     * @param key: key identifying the data, such as a hash of the input it was generated from
+     * @param compression_level: (optional) zstd compression level, or 0 for no compression
+     */
+    BinaryWriter(uint32_t version, uint64_t key, int compression_level = 0)
+        : m_version(version)
+        , m_key(key)
+        , m_compression_level(compression_level)
+    {}
+
+    // add a copy of an array
+    template <typename Derived>
+    void add(const std::string& name, const Eigen::DenseBase<Derived>& array)
+    {
+        typedef typename Derived::Scalar T;
+        Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> matrix = array;
+        Entry entry = create_entry<T>(name, matrix.rows(), matrix.cols());
+        entry.storage.resize(entry.size);
+        if (entry.size > 0) std::memcpy(entry.storage.data(), matrix.data(), entry.size);
+        m_entries.push_back(std::move(entry));
+    }
+
+    // add an array without copying it, which must remain valid until the container is written
+    template <typename Derived>
+    void add_reference(const std::string& name, const Eigen::PlainObjectBase<Derived>& array)
+    {
+        typedef typename Derived::Scalar T;
+        static_assert((!Derived::IsRowMajor) || (Derived::RowsAtCompileTime == 1));
+        Entry entry = create_entry<T>(name, array.rows(), array.cols());
+        entry.reference = reinterpret_cast<const char*>(array.data());
+        m_entries.push_back(std::move(entry));
+    }
+
+    /**
+     * @brief Write the container to file.
+     *
+     * @param filename: output file path
+     * @return true iff the file was written successfully
+     */
+    bool write(const std::string& filename)
+    {
+        bool use_compression = (m_compression_level > 0);
+#ifndef USE_ZSTD
+        if (use_compression) {
+            spdlog::warn("Built without zstd, so {} is written uncompressed", filename);
+            use_compression = false;
+        }
+#endif
+
+        std::ofstream output_file(filename, std::ios::binary | std::ios::trunc);
+        if (!output_file) {
+            spdlog::error("Could not open {} for writing", filename);
+            return false;
+        }
+
+        // reserve space for the header and section table
+        uint64_t position = sizeof(BinaryHeader) + m_entries.size() * sizeof(BinarySection);
+        std::vector<char> table_space(position, 0);
+        output_file.write(table_space.data(), table_space.size());
+
+        // stream aligned arrays and record their offsets
+        const char padding[64] = {};
+        for (auto& entry : m_entries) {
+            uint64_t offset = align(position);
+            output_file.write(padding, offset - position);
+            entry.section.offset = offset;
+            const char* data = (entry.reference != nullptr) ? entry.reference : entry.storage.data();
+            if (use_compression) {
+                entry.section.compression = BinaryCompression::zstd;
+                uint64_t compressed_size = write_compressed(output_file, data, entry.size);
+                if (compressed_size == 0) {
+                    spdlog::error("Could not compress {} in {}", entry.section.name, filename);
+                    return false;
+                }
+                position = offset + compressed_size;
+            } else {
+                output_file.write(data, entry.size);
+                position = offset + entry.size;
+            }
+        }
+
+        // write the header and section table
+        BinaryHeader header;
+        header.version = m_version;
+        header.key = m_key;
+        header.num_sections = m_entries.size();
+        output_file.seekp(0);
+        output_file.write(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader));
+        for (const auto& entry : m_entries) {
+            output_file.write(reinterpret_cast<const char*>(&entry.section), sizeof(BinarySection));
+        }
+
+        return static_cast<bool>(output_file);
+    }
+
+private:
+    struct Entry
+    {
+        BinarySection section;
+        std::vector<char> storage;
+        const char* reference = nullptr;
+        uint64_t size = 0;
+    };
+
+    template <typename T>
+    static Entry create_entry(const std::string& name, int64_t rows, int64_t cols)
+    {
+        Entry entry;
+        entry.section.type = binary_type<T>();
+        entry.section.rows = rows;
+        entry.section.cols = cols;
+        std::strncpy(entry.section.name, name.c_str(), sizeof(entry.section.name) - 1);
+        entry.size = rows * cols * sizeof(T);
+        return entry;
+    }
+
+    static uint64_t align(uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+
+    // write compressed blocks of data, returning the number of bytes written or 0 on failure
+    uint64_t write_compressed(std::ofstream& output_file, const char* data, uint64_t size) const
+    {
+#ifdef USE_ZSTD
+        // write block table placeholder
+        uint64_t num_blocks = (size + BINARY_BLOCK_SIZE - 1) / BINARY_BLOCK_SIZE;
+        std::vector<uint64_t> block_table(num_blocks + 2, 0);
+        block_table[0] = BINARY_BLOCK_SIZE;
+        block_table[1] = num_blocks;
+        std::streampos table_position = output_file.tellp();
+        uint64_t table_size = block_table.size() * sizeof(uint64_t);
+        output_file.write(reinterpret_cast<const char*>(block_table.data()), table_size);
+
+        // compress batches of blocks in parallel and stream them so that only one batch is held
+        int batch_size = 4 * get_num_threads();
+        std::vector<std::vector<char>> blocks(batch_size);
+        std::atomic<bool> is_valid(true);
+        uint64_t total_size = table_size;
+        for (uint64_t batch_begin = 0; batch_begin < num_blocks; batch_begin += batch_size) {
+            uint64_t batch_end = std::min<uint64_t>(batch_begin + batch_size, num_blocks);
+            parallel_for(batch_end - batch_begin, [&](int64_t i) {
+                uint64_t begin = (batch_begin + i) * BINARY_BLOCK_SIZE;
+                uint64_t block_size = std::min(BINARY_BLOCK_SIZE, size - begin);
+                std::vector<char>& block = blocks[i];
+                block.resize(ZSTD_compressBound(block_size));
+                size_t compressed_size =
+                    ZSTD_compress(block.data(), block.size(), data + begin, block_size, m_compression_level);
+                if (ZSTD_isError(compressed_size)) {
+                    is_valid = false;
+                    compressed_size = 0;
+                }
+                block.resize(compressed_size);
+            });
+            for (uint64_t bi = batch_begin; bi < batch_end; ++bi) {
+                const std::vector<char>& block = blocks[bi - batch_begin];
+                output_file.write(block.data(), block.size());
+                block_table[bi + 2] = block.size();
+                total_size += block.size();
+            }
+        }
+        if (!is_valid) return 0;
+
+        // fill in the block table
+        std::streampos end_position = output_file.tellp();
+        output_file.seekp(table_position);
+        output_file.write(reinterpret_cast<const char*>(block_table.data()), table_size);
+        output_file.seekp(end_position);
+        return total_size;
+#else
+        (void)output_file, (void)data, (void)size;
+        return 0;
+#endif
+    }
+
+    uint32_t m_version;
+    uint64_t m_key;
+    int m_compression_level;
+    std::vector<Entry> m_entries;
+};
+
+/**
+ * @brief Memory mapped reader for a binary container.
+ *
+ * Arrays are exposed as read only Eigen maps into the mapped file, which remain valid for the
+ * lifetime of the reader. Compressed arrays are decompressed in parallel on first access and
+ * kept by the reader, so they should be accessed from a single thread.
+ */
+class BinaryReader
+{
+public:
+    template <typename T>
+    using ArrayMap = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>>;
+
+    BinaryReader(const std::string& filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat file_stat;
+        if ((::fstat(fd, &file_stat) == 0) && (file_stat.st_size >= (off_t)sizeof(BinaryHeader))) {
+            m_size = file_stat.st_size;
+            void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) m_data = static_cast<const char*>(data);
+        }
+        ::close(fd);
+        if (m_data == nullptr) return;
+
+        // validate header and section table, bounding counts before multiplying them
+        std::memcpy(&m_header, m_data, sizeof(BinaryHeader));
+        uint64_t max_sections = (m_size - sizeof(BinaryHeader)) / sizeof(BinarySection);
+        if ((m_header.magic != BINARY_MAGIC) || (m_header.num_sections > max_sections)) {
+            spdlog::warn("Invalid binary container {}", filename);
+            unmap();
+            return;
+        }
+        const BinarySection* sections =
+            reinterpret_cast<const BinarySection*>(m_data + sizeof(BinaryHeader));
+        for (uint64_t i = 0; i < m_header.num_sections; ++i) {
+            const BinarySection& section = sections[i];
+            uint64_t array_size;
+            bool is_valid_section = (section.offset <= m_size) && (array_byte_size(section, array_size));
+            uint64_t section_size = 0;
+            if (is_valid_section) {
+                section_size = (section.compression == BinaryCompression::none) ? array_size
+                                                                               : compressed_size(section);
+                bool is_invalid_table = ((section_size == 0) && (array_size > 0));
+                is_valid_section = (!is_invalid_table) && (section_size <= m_size - section.offset);
+            }
+            if (!is_valid_section) {
+                spdlog::warn("Truncated binary container {}", filename);
+                unmap();
+                return;
+            }
+            m_sections[std::string(section.name, strnlen(section.name, sizeof(section.name)))] =
+                section;
+        }
+    }
+
+    ~BinaryReader() { unmap(); }
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    bool is_valid() const { return (m_data != nullptr); }
+    uint32_t version() const { return m_header.version; }
+    uint64_t key() const { return m_header.key; }
+
+    bool has(const std::string& name) const { return (m_sections.find(name) != m_sections.end()); }
+
+    /**
+     * @brief View a named array in the mapped file.
+     *
+     * @param name: name of the array
+     * @return map of the array, or an empty map if it is missing or has a different type
+     */
+    template <typename T>
+    ArrayMap<T> get(const std::string& name) const
+    {
+        auto itr = m_sections.find(name);
+        if ((itr == m_sections.end()) || (itr->second.type != binary_type<T>())) {
+            return ArrayMap<T>(nullptr, 0, 0);
+        }
+        const BinarySection& section = itr->second;
+        const char* data = m_data + section.offset;
+        if (section.compression != BinaryCompression::none) {
+            data = decompress(name, section);
+            if (data == nullptr) return ArrayMap<T>(nullptr, 0, 0);
+        }
+        return ArrayMap<T>(reinterpret_cast<const T*>(data), section.rows, section.cols);
+    }
+
+private:
+    // get the uncompressed size of a section array, or false if it is invalid or overflows
+    static bool array_byte_size(const BinarySection& section, uint64_t& size)
+    {
+        if ((section.rows < 0) || (section.cols < 0)) return false;
+        if ((section.type != BinaryType::float64) && (section.type != BinaryType::int32)) return false;
+        uint64_t rows = section.rows, cols = section.cols, type_size = binary_type_size(section.type);
+        if ((cols > 0) && (rows > UINT64_MAX / type_size / cols)) return false;
+        size = rows * cols * type_size;
+        return true;
+    }
+
+    // get the size of a compressed section, or 0 if its block table is invalid, where the
+    // section offset is at most the file size
+    uint64_t compressed_size(const BinarySection& section) const
+    {
+        uint64_t available_size = m_size - section.offset;
+        if ((section.compression != BinaryCompression::zstd) || (available_size < 16)) return 0;
+        const uint64_t* block_table = reinterpret_cast<const uint64_t*>(m_data + section.offset);
+        uint64_t block_size = block_table[0];
+        uint64_t num_blocks = block_table[1];
+        uint64_t size;
+        if ((!array_byte_size(section, size)) || (block_size == 0)) return 0;
+        if (num_blocks != size / block_size + ((size % block_size > 0) ? 1 : 0)) return 0;
+        if (num_blocks > available_size / sizeof(uint64_t) - 2) return 0;
+        uint64_t total_size = (num_blocks + 2) * sizeof(uint64_t);
+        for (uint64_t bi = 0; bi < num_blocks; ++bi) {
+            if (block_table[bi + 2] > available_size - total_size) return 0;
+            total_size += block_table[bi + 2];
+        }
+        return total_size;
+    }
+
+    // decompress a section in parallel, or return nullptr on failure
+    const char* decompress(const std::string& name, const BinarySection& section) const
+    {
+        auto itr = m_decompressed.find(name);
+        if (itr != m_decompressed.end()) return itr->second.data();
+#ifdef USE_ZSTD
+        const uint64_t* block_table = reinterpret_cast<const uint64_t*>(m_data + section.offset);
+        uint64_t block_size = block_table[0];
+        uint64_t num_blocks = block_table[1];
+        std::vector<uint64_t> block_offsets(num_blocks + 1);
+        block_offsets[0] = section.offset + (num_blocks + 2) * sizeof(uint64_t);
+        for (uint64_t bi = 0; bi < num_blocks; ++bi) {
+            block_offsets[bi + 1] = block_offsets[bi] + block_table[bi + 2];
+        }
+
+        uint64_t size = section.rows * section.cols * binary_type_size(section.type);
+        std::vector<char> data(std::max<uint64_t>(size, 1)); // nonempty for a valid pointer
+        std::atomic<bool> is_valid(true);
+        parallel_for(num_blocks, [&](int64_t bi) {
+            uint64_t begin = bi * block_size;
+            uint64_t expected_size = std::min(block_size, size - begin);
+            size_t decompressed_size = ZSTD_decompress(
+                data.data() + begin,
+                expected_size,
+                m_data + block_offsets[bi],
+                block_offsets[bi + 1] - block_offsets[bi]);
+            if ((ZSTD_isError(decompressed_size)) || (decompressed_size != expected_size)) {
+                is_valid = false;
+            }
+        });
+        if (!is_valid) {
+            spdlog::error("Could not decompress {}", name);
+            return nullptr;
+        }
+        return m_decompressed.emplace(name, std::move(data)).first->second.data();
+#else
+        (void)section;
+        spdlog::error("Built without zstd, so compressed {} cannot be read", name);
+        return nullptr;
+#endif
+    }
+
+    void unmap()
+    {
+        if (m_data != nullptr) ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_sections.clear();
+        m_decompressed.clear();
+    }
+
+    const char* m_data = nullptr;
+    uint64_t m_size = 0;
+    BinaryHeader m_header;
+    std::map<std::string, BinarySection> m_sections;
+    mutable std::map<std::string, std::vector<char>> m_decompressed;
+};
+
+} // namespace Penner
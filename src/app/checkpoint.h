@@ -0,0 +1,111 @@
+#pragma once
+
+#include "field_cache.h"
+
+#include <filesystem>
+
+namespace Penner {
+
+// Increment when the checkpointed data changes
+constexpr uint32_t PARAMETERIZATION_CHECKPOINT_VERSION = 2;
+
+/**
+ * @brief Refined mesh, parameterization, features and field produced by the metric optimization
+ */
+struct RefinedParameterization
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    Eigen::MatrixXd uv;
+    Eigen::MatrixXi FT;
+    Eigen::VectorXi fn_to_f; // map from refined faces to input faces
+    Eigen::MatrixXi is_feature; // per corner mask of features opposite the corner
+    std::vector<VertexEdge> feature_edges;
+    std::vector<VertexEdge> misaligned_edges;
+    Eigen::MatrixXd reference_field;
+    Eigen::VectorXd theta;
+    Eigen::MatrixXd kappa;
+    Eigen::MatrixXi period_jump;
+};
+
+/**
+ * @brief Write a checkpoint of the refined parameterization before uv optimization.
+ *
+ * @param checkpoint_filename: path for the checkpoint file
+ * @param key: hash of the input mesh and the options the parameterization was generated with
+ * @param parameterization: refined parameterization to checkpoint
+ * @return true iff the checkpoint was written
+ */
+inline bool write_parameterization_checkpoint(
+    const std::string& checkpoint_filename,
+    uint64_t key,
+    const RefinedParameterization& parameterization)
+{
+    BinaryWriter writer(PARAMETERIZATION_CHECKPOINT_VERSION, key);
+    writer.add("V", parameterization.V);
+    writer.add("F", parameterization.F);
+    writer.add("uv", parameterization.uv);
+    writer.add("FT", parameterization.FT);
+    writer.add("fn_to_f", parameterization.fn_to_f);
+    writer.add("is_feature", parameterization.is_feature);
+    writer.add("feature_edges", generate_edge_matrix(parameterization.feature_edges));
+    writer.add("misaligned_edges", generate_edge_matrix(parameterization.misaligned_edges));
+    writer.add("reference_field", parameterization.reference_field);
+    writer.add("theta", parameterization.theta);
+    writer.add("kappa", parameterization.kappa);
+    writer.add("period_jump", parameterization.period_jump);
+
+    // write to a temporary file first so an interrupted write never replaces a valid checkpoint
+    std::string temp_filename = checkpoint_filename + ".tmp";
+    if (!writer.write(temp_filename)) return false;
+    std::error_code error_code;
+    std::filesystem::rename(temp_filename, checkpoint_filename, error_code);
+    return !error_code;
+}
+
+/**
+ * @brief Load a checkpoint of the refined parameterization.
+ *
+ * The checkpoint is only used if its version is current and its key matches the given key.
+ *
+ * @param checkpoint_filename: path of the checkpoint file
+ * @param key: hash of the current input mesh and options
+ * @param parameterization: loaded refined parameterization
+ * @return true iff a valid checkpoint was loaded
+ */
+inline bool load_parameterization_checkpoint(
+    const std::string& checkpoint_filename,
+    uint64_t key,
+    RefinedParameterization& parameterization)
+{
+    BinaryReader reader(checkpoint_filename);
+    if (!reader.is_valid()) return false;
+    if ((reader.version() != PARAMETERIZATION_CHECKPOINT_VERSION) || (reader.key() != key)) {
+        spdlog::info("Ignoring outdated checkpoint {}", checkpoint_filename);
+        return false;
+    }
+    for (std::string name : {"V", "F", "uv", "FT", "fn_to_f", "is_feature", "feature_edges",
+                             "misaligned_edges", "reference_field", "theta", "kappa",
+                             "period_jump"}) {
+        if (!reader.has(name)) {
+            spdlog::warn("Checkpoint {} is missing {}", checkpoint_filename, name);
+            return false;
+        }
+    }
+
+    parameterization.V = reader.get<double>("V");
+    parameterization.F = reader.get<int>("F");
+    parameterization.uv = reader.get<double>("uv");
+    parameterization.FT = reader.get<int>("FT");
+    parameterization.fn_to_f = reader.get<int>("fn_to_f");
+    parameterization.is_feature = reader.get<int>("is_feature");
+    parameterization.feature_edges = generate_edge_list(reader.get<int>("feature_edges"));
+    parameterization.misaligned_edges = generate_edge_list(reader.get<int>("misaligned_edges"));
+    parameterization.reference_field = reader.get<double>("reference_field");
+    parameterization.theta = reader.get<double>("theta");
+    parameterization.kappa = reader.get<double>("kappa");
+    parameterization.period_jump = reader.get<int>("period_jump");
+    return true;
+}
+
+} // namespace Penner
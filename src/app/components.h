@@ -0,0 +1,432 @@
+#pragma once
+
+#include "binary_io.h"
+#include "parallel.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace Penner {
+
+// Increment when the packed component format changes
+constexpr uint32_t PACKED_COMPONENTS_VERSION = 1;
+
+/**
+ * @brief Submesh and layout of a single connected component of a parameterized mesh
+ */
+struct MeshComponent
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    Eigen::MatrixXd uv;
+    Eigen::MatrixXi FT;
+};
+
+/**
+ * @brief Partition faces by component with a counting sort.
+ *
+ * @param components: per face component index
+ * @param num_components: number of components
+ * @param component_faces: faces sorted by component, in increasing order within each component
+ * @param component_offsets: offsets of the faces of each component in the sorted face list
+ */
+inline void partition_components(
+    const Eigen::VectorXi& components,
+    int num_components,
+    std::vector<int>& component_faces,
+    std::vector<int>& component_offsets)
+{
+    int num_faces = components.size();
+    component_offsets.assign(num_components + 1, 0);
+    for (int fi = 0; fi < num_faces; ++fi) {
+        ++component_offsets[components[fi] + 1];
+    }
+    for (int ci = 0; ci < num_components; ++ci) {
+        component_offsets[ci + 1] += component_offsets[ci];
+    }
+
+    std::vector<int> position(component_offsets.begin(), component_offsets.end() - 1);
+    component_faces.resize(num_faces);
+    for (int fi = 0; fi < num_faces; ++fi) {
+        component_faces[position[components[fi]]++] = fi;
+    }
+}
+
+/**
+ * @brief List the vertices of each component in increasing order.
+ *
+ * The distinct vertices of all components are bucketed by vertex index with a counting sort,
+ * so the cost is linear in the mesh size rather than sorting each component separately.
+ *
+ * @param F: mesh faces
+ * @param num_vertices: number of mesh vertices
+ * @param component_faces: faces sorted by component
+ * @param component_offsets: offsets of the faces of each component in the sorted face list
+ * @param component_vertices: vertices sorted by component, in increasing order within each component
+ * @param vertex_offsets: offsets of the vertices of each component in the sorted vertex list
+ */
+inline void order_component_vertices(
+    const Eigen::MatrixXi& F,
+    int num_vertices,
+    const std::vector<int>& component_faces,
+    const std::vector<int>& component_offsets,
+    std::vector<int>& component_vertices,
+    std::vector<int>& vertex_offsets)
+{
+    int num_components = component_offsets.size() - 1;
+
+    // call func(ci, vi) once for each distinct vertex vi of each component ci
+    std::vector<int> last_component(num_vertices);
+    auto for_each_component_vertex = [&](const auto& func) {
+        std::fill(last_component.begin(), last_component.end(), -1);
+        for (int ci = 0; ci < num_components; ++ci) {
+            for (int i = component_offsets[ci]; i < component_offsets[ci + 1]; ++i) {
+                for (int j = 0; j < F.cols(); ++j) {
+                    int vi = F(component_faces[i], j);
+                    if (last_component[vi] == ci) continue;
+                    last_component[vi] = ci;
+                    func(ci, vi);
+                }
+            }
+        }
+    };
+
+    // count the components of each vertex and the vertices of each component
+    std::vector<int> component_counts(num_vertices + 1, 0);
+    vertex_offsets.assign(num_components + 1, 0);
+    for_each_component_vertex([&](int ci, int vi) {
+        ++component_counts[vi + 1];
+        ++vertex_offsets[ci + 1];
+    });
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        component_counts[vi + 1] += component_counts[vi];
+    }
+    for (int ci = 0; ci < num_components; ++ci) {
+        vertex_offsets[ci + 1] += vertex_offsets[ci];
+    }
+
+    // bucket components by vertex
+    std::vector<int> vertex_components(component_counts[num_vertices]);
+    std::vector<int> position(component_counts.begin(), component_counts.end() - 1);
+    for_each_component_vertex([&](int ci, int vi) { vertex_components[position[vi]++] = ci; });
+
+    // scatter vertices to their components in increasing order
+    component_vertices.resize(vertex_offsets[num_components]);
+    position.assign(vertex_offsets.begin(), vertex_offsets.end() - 1);
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        for (int k = component_counts[vi]; k < component_counts[vi + 1]; ++k) {
+            component_vertices[position[vertex_components[k]]++] = vi;
+        }
+    }
+}
+
+/**
+ * @brief Faces and ordered mesh and layout vertices of each component, stored as offset lists
+ */
+struct ComponentPartition
+{
+    std::vector<int> faces, face_offsets;
+    std::vector<int> vertices, vertex_offsets;
+    std::vector<int> uv_vertices, uv_offsets;
+
+    int num_components() const { return face_offsets.size() - 1; }
+};
+
+/**
+ * @brief Partition the faces, mesh vertices and layout vertices of a mesh by component.
+ *
+ * @param num_vertices: number of mesh vertices
+ * @param F: mesh faces
+ * @param num_uv_vertices: number of layout vertices
+ * @param FT: layout faces
+ * @param components: per face component index
+ * @param num_components: number of components
+ * @return component partition
+ */
+inline ComponentPartition partition_mesh_components(
+    int num_vertices,
+    const Eigen::MatrixXi& F,
+    int num_uv_vertices,
+    const Eigen::MatrixXi& FT,
+    const Eigen::VectorXi& components,
+    int num_components)
+{
+    ComponentPartition partition;
+    partition_components(components, num_components, partition.faces, partition.face_offsets);
+    order_component_vertices(
+        F,
+        num_vertices,
+        partition.faces,
+        partition.face_offsets,
+        partition.vertices,
+        partition.vertex_offsets);
+    order_component_vertices(
+        FT,
+        num_uv_vertices,
+        partition.faces,
+        partition.face_offsets,
+        partition.uv_vertices,
+        partition.uv_offsets);
+    return partition;
+}
+
+// copy the rows of the ordered vertices of a subset of faces and reindex the faces into
+// presized outputs, using and then resetting a workspace map that is initialized to -1
+inline void reindex_component_faces(
+    const Eigen::MatrixXd& X,
+    const Eigen::MatrixXi& F,
+    const int* faces,
+    int num_component_faces,
+    const int* vertices,
+    int num_component_vertices,
+    std::vector<int>& index_map,
+    Eigen::Ref<Eigen::MatrixXd> X_c,
+    Eigen::Ref<Eigen::MatrixXi> F_c)
+{
+    // assign new indices preserving the original vertex order, as in igl::remove_unreferenced
+    for (int i = 0; i < num_component_vertices; ++i) {
+        index_map[vertices[i]] = i;
+        X_c.row(i) = X.row(vertices[i]);
+    }
+
+    // reindex faces and reset the workspace
+    for (int i = 0; i < num_component_faces; ++i) {
+        for (int j = 0; j < F.cols(); ++j) {
+            F_c(i, j) = index_map[F(faces[i], j)];
+        }
+    }
+    for (int i = 0; i < num_component_vertices; ++i) {
+        index_map[vertices[i]] = -1;
+    }
+}
+
+// reindex the mesh and layout of each component in parallel with per thread workspaces, calling
+// get_outputs(ci, num_vertices, num_uv_vertices, num_faces) for presized V, F, uv and FT outputs
+// and then process_outputs(ci)
+template <typename OutputFunc, typename ProcessFunc>
+void reindex_components(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const ComponentPartition& partition,
+    const OutputFunc& get_outputs,
+    const ProcessFunc& process_outputs)
+{
+    int num_threads = get_num_threads();
+    std::vector<std::vector<int>> vertex_maps(num_threads), uv_maps(num_threads);
+    parallel_for_dynamic(partition.num_components(), [&](int64_t ci, int thread) {
+        if (vertex_maps[thread].empty()) {
+            vertex_maps[thread].assign(V.rows(), -1);
+            uv_maps[thread].assign(uv.rows(), -1);
+        }
+
+        const int* faces = partition.faces.data() + partition.face_offsets[ci];
+        const int* vertices = partition.vertices.data() + partition.vertex_offsets[ci];
+        const int* uv_vertices = partition.uv_vertices.data() + partition.uv_offsets[ci];
+        int num_component_faces = partition.face_offsets[ci + 1] - partition.face_offsets[ci];
+        int num_component_vertices = partition.vertex_offsets[ci + 1] - partition.vertex_offsets[ci];
+        int num_component_uv_vertices = partition.uv_offsets[ci + 1] - partition.uv_offsets[ci];
+        auto [V_c, F_c, uv_c, FT_c] =
+            get_outputs(ci, num_component_vertices, num_component_uv_vertices, num_component_faces);
+        reindex_component_faces(
+            V,
+            F,
+            faces,
+            num_component_faces,
+            vertices,
+            num_component_vertices,
+            vertex_maps[thread],
+            V_c,
+            F_c);
+        reindex_component_faces(
+            uv,
+            FT,
+            faces,
+            num_component_faces,
+            uv_vertices,
+            num_component_uv_vertices,
+            uv_maps[thread],
+            uv_c,
+            FT_c);
+        process_outputs(ci);
+    });
+}
+
+/**
+ * @brief Extract all connected components of a parameterized mesh in parallel.
+ *
+ * The vertices of all components are ordered with a single counting sort, so the cost is
+ * linear in the mesh size, independent of the number of components.
+ *
+ * @param V: mesh vertices
+ * @param F: mesh faces
+ * @param uv: layout vertices
+ * @param FT: layout faces
+ * @param components: per face component index
+ * @param num_components: number of components
+ * @param process_component: (optional) function called as process_component(ci, component)
+ *     on the thread extracting the component; if provided, components are not retained
+ * @return extracted components (empty if process_component is provided)
+ */
+template <typename Func>
+std::vector<MeshComponent> extract_components(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const Eigen::VectorXi& components,
+    int num_components,
+    const Func& process_component)
+{
+    ComponentPartition partition =
+        partition_mesh_components(V.rows(), F, uv.rows(), FT, components, num_components);
+
+    // extract components to be retained or to a per component buffer that is processed in place
+    constexpr bool retain_components = std::is_same_v<Func, std::nullptr_t>;
+    std::vector<MeshComponent> mesh_components(num_components);
+    auto get_outputs = [&](int ci, int num_vertices, int num_uv_vertices, int num_faces) {
+        MeshComponent& component = mesh_components[ci];
+        component.V.resize(num_vertices, V.cols());
+        component.F.resize(num_faces, F.cols());
+        component.uv.resize(num_uv_vertices, uv.cols());
+        component.FT.resize(num_faces, FT.cols());
+        return std::tie(component.V, component.F, component.uv, component.FT);
+    };
+    auto process_outputs = [&](int ci) {
+        if constexpr (!retain_components) {
+            process_component(ci, mesh_components[ci]);
+            mesh_components[ci] = MeshComponent();
+        }
+    };
+    reindex_components(V, F, uv, FT, partition, get_outputs, process_outputs);
+
+    if constexpr (!retain_components) mesh_components.clear();
+    return mesh_components;
+}
+
+inline std::vector<MeshComponent> extract_components(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const Eigen::VectorXi& components,
+    int num_components)
+{
+    return extract_components(V, F, uv, FT, components, num_components, nullptr);
+}
+
+/**
+ * @brief Write all connected components of a parameterized mesh to a single packed binary file.
+ *
+ * The component vertices and faces are concatenated, with component local indices, and the
+ * start of each component is recorded in offset arrays. The offsets are known from the
+ * component partition, so each component is reindexed in parallel directly into its slice of
+ * the packed arrays without an intermediate copy.
+ *
+ * @param filename: path for the packed file
+ * @param V: mesh vertices
+ * @param F: mesh faces
+ * @param uv: layout vertices
+ * @param FT: layout faces
+ * @param components: per face component index
+ * @param num_components: number of components
+ * @return true iff the file was written
+ */
+inline bool write_packed_components(
+    const std::string& filename,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const Eigen::VectorXi& components,
+    int num_components)
+{
+    ComponentPartition partition =
+        partition_mesh_components(V.rows(), F, uv.rows(), FT, components, num_components);
+    const std::vector<int>& V_offsets = partition.vertex_offsets;
+    const std::vector<int>& F_offsets = partition.face_offsets;
+    const std::vector<int>& uv_offsets = partition.uv_offsets;
+
+    // reindex components into their slices of the packed arrays
+    Eigen::MatrixXd V_packed(V_offsets[num_components], V.cols());
+    Eigen::MatrixXi F_packed(F_offsets[num_components], F.cols());
+    Eigen::MatrixXd uv_packed(uv_offsets[num_components], uv.cols());
+    Eigen::MatrixXi FT_packed(F_offsets[num_components], FT.cols());
+    auto get_outputs = [&](int ci, int num_vertices, int num_uv_vertices, int num_faces) {
+        return std::make_tuple(
+            V_packed.middleRows(V_offsets[ci], num_vertices),
+            F_packed.middleRows(F_offsets[ci], num_faces),
+            uv_packed.middleRows(uv_offsets[ci], num_uv_vertices),
+            FT_packed.middleRows(F_offsets[ci], num_faces));
+    };
+    reindex_components(V, F, uv, FT, partition, get_outputs, [](int) {});
+
+    BinaryWriter writer(PACKED_COMPONENTS_VERSION, 0);
+    writer.add("V_offsets", Eigen::Map<const Eigen::VectorXi>(V_offsets.data(), V_offsets.size()));
+    writer.add("F_offsets", Eigen::Map<const Eigen::VectorXi>(F_offsets.data(), F_offsets.size()));
+    writer.add("uv_offsets", Eigen::Map<const Eigen::VectorXi>(uv_offsets.data(), uv_offsets.size()));
+    writer.add_reference("V", V_packed);
+    writer.add_reference("F", F_packed);
+    writer.add_reference("uv", uv_packed);
+    writer.add_reference("FT", FT_packed);
+    return writer.write(filename);
+}
+
+/**
+ * @brief Load components from a packed binary file.
+ *
+ * The offsets are checked to partition the packed arrays, so a corrupt file is rejected.
+ *
+ * @param filename: path of the packed file
+ * @param mesh_components: loaded components
+ * @return true iff the file was loaded
+ */
+inline bool load_packed_components(
+    const std::string& filename,
+    std::vector<MeshComponent>& mesh_components)
+{
+    BinaryReader reader(filename);
+    if ((!reader.is_valid()) || (reader.version() != PACKED_COMPONENTS_VERSION)) {
+        spdlog::error("Could not load packed components from {}", filename);
+        return false;
+    }
+    auto V_offsets = reader.get<int>("V_offsets");
+    auto F_offsets = reader.get<int>("F_offsets");
+    auto uv_offsets = reader.get<int>("uv_offsets");
+    auto V = reader.get<double>("V");
+    auto F = reader.get<int>("F");
+    auto uv = reader.get<double>("uv");
+    auto FT = reader.get<int>("FT");
+
+    // check that the offsets partition the packed arrays before viewing slices of them
+    int num_components = std::max<int>(V_offsets.size() - 1, 0);
+    auto is_partition = [num_components](const auto& offsets, int64_t num_rows) {
+        if ((offsets.size() != num_components + 1) || (offsets(0) != 0)) return false;
+        for (int ci = 0; ci < num_components; ++ci) {
+            if (offsets(ci + 1) < offsets(ci)) return false;
+        }
+        return (offsets(num_components) == num_rows);
+    };
+    if ((V_offsets.size() == 0) || (FT.rows() != F.rows()) || (!is_partition(V_offsets, V.rows())) ||
+        (!is_partition(F_offsets, F.rows())) || (!is_partition(uv_offsets, uv.rows()))) {
+        spdlog::error("Inconsistent packed components in {}", filename);
+        return false;
+    }
+    mesh_components.resize(num_components);
+    parallel_for(num_components, [&](int64_t ci) {
+        MeshComponent& component = mesh_components[ci];
+        component.V = V.middleRows(V_offsets(ci), V_offsets(ci + 1) - V_offsets(ci));
+        component.F = F.middleRows(F_offsets(ci), F_offsets(ci + 1) - F_offsets(ci));
+        component.uv = uv.middleRows(uv_offsets(ci), uv_offsets(ci + 1) - uv_offsets(ci));
+        component.FT = FT.middleRows(F_offsets(ci), F_offsets(ci + 1) - F_offsets(ci));
+    });
+
+    return true;
+}
+
+} // namespace Penner
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "feature/core/common.h"
+#include "halfedge_connectivity.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <vector>
+
+namespace Penner {
+
+/**
+ * @brief Cone data for the corners of a parameterized mesh
+ */
+struct ConeCorners
+{
+    Eigen::MatrixXi is_cone; // per corner cone mask
+    Eigen::MatrixXi vertex_indices; // per corner index of the vertex of the mesh cut at features
+    Eigen::MatrixXd corner_cone_angles; // per corner cone angle of the cut vertex
+    Eigen::VectorXi is_boundary; // per vertex mask of vertices on features
+};
+
+/**
+ * @brief Find the corners of a parameterized mesh at cones, treating features as boundaries.
+ *
+ * Corners are unioned across non-feature edges in parallel while their uv angles are computed
+ * with the same law of cosines formula as igl::internal_angles. Angles are accumulated per cut
+ * vertex in corner order, so the result is identical to a serial computation.
+ *
+ * @param F: mesh faces
+ * @param uv: layout vertices
+ * @param FT: layout faces
+ * @param is_feature: per corner mask of feature edges opposite the corner
+ * @param connectivity: halfedge connectivity of the mesh faces
+ * @return cone corner data
+ */
+inline ConeCorners compute_cone_corners(
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const Eigen::MatrixXi& is_feature,
+    const HalfedgeConnectivity& connectivity)
+{
+    int num_vertices = connectivity.num_vertices;
+    int num_faces = FT.rows();
+    int num_halfedges = 3 * num_faces;
+    ConeCorners cone_corners;
+
+    // mark vertices on features
+    cone_corners.is_boundary = Eigen::VectorXi::Zero(num_vertices);
+    for (int f = 0; f < num_faces; ++f) {
+        for (int i = 0; i < 3; ++i) {
+            if (is_feature(f, (i + 2) % 3)) cone_corners.is_boundary(F(f, i)) = 1;
+        }
+    }
+
+    // union corners across non feature edges and compute uv corner angles
+    ConcurrentUnionFind cut_vertices(num_halfedges);
+    Eigen::MatrixXd corner_angles(num_faces, 3);
+    parallel_for(num_faces, [&](int64_t f) {
+        double l_sq[3];
+        for (int i = 0; i < 3; ++i) {
+            // squared length of the edge opposite corner i
+            auto d = uv.row(FT(f, (i + 1) % 3)) - uv.row(FT(f, (i + 2) % 3));
+            l_sq[i] = d.squaredNorm();
+
+            // union tips across edge from vertex i unless it is a feature
+            int h = 3 * f + i;
+            int h_opp = connectivity.opposite[h];
+            if ((is_feature(f, (i + 2) % 3)) || (h_opp < 0)) continue;
+            int f_opp = h_opp / 3;
+            int j = h_opp % 3;
+            cut_vertices.union_sets(h, 3 * f_opp + (j + 1) % 3);
+        }
+        for (int i = 0; i < 3; ++i) {
+            double s1 = l_sq[i];
+            double s2 = l_sq[(i + 1) % 3];
+            double s3 = l_sq[(i + 2) % 3];
+            corner_angles(f, i) = std::acos((s3 + s2 - s1) / (2. * std::sqrt(s3 * s2)));
+        }
+    });
+
+    // compute cone angles of unioned vertices
+    int num_cut_vertices;
+    std::vector<int> set_index = cut_vertices.index_sets(num_cut_vertices);
+    std::vector<double> cone_angles(num_cut_vertices, 0.);
+    for (int h = 0; h < num_halfedges; ++h) {
+        cone_angles[set_index[h]] += corner_angles(h / 3, h % 3);
+    }
+
+    // tag corners with cone angles differing from flat interior or boundary angles
+    cone_corners.is_cone = Eigen::MatrixXi::Zero(num_faces, 3);
+    cone_corners.vertex_indices.resize(num_faces, 3);
+    cone_corners.corner_cone_angles.resize(num_faces, 3);
+    parallel_for(num_faces, [&](int64_t f) {
+        for (int i = 0; i < 3; ++i) {
+            int v = set_index[3 * f + i];
+            double angle = cone_angles[v];
+            cone_corners.vertex_indices(f, i) = v;
+            cone_corners.corner_cone_angles(f, i) = angle;
+            bool is_boundary = cone_corners.is_boundary[F(f, i)];
+            if (((!is_boundary) && (!float_equal(angle, 2 * PI))) ||
+                ((is_boundary) && (!float_equal(angle, PI)))) {
+                cone_corners.is_cone(f, i) = 1;
+            }
+        }
+    });
+
+    return cone_corners;
+}
+
+} // namespace Penner
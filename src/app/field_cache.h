@@ -0,0 +1,125 @@
+#pragma once
+
+#include "feature/core/common.h"
+#include "binary_io.h"
+
+#include <filesystem>
+
+namespace Penner {
+
+// Increment when the cached data or the preprocessing that generates it changes
+constexpr uint32_t FIELD_CACHE_VERSION = 1;
+
+/**
+ * @brief Preprocessed feature mesh and frame field used as input to the alignment pipeline
+ */
+struct FeatureFieldData
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    std::vector<VertexEdge> feature_edges;
+    std::vector<VertexEdge> hard_feature_edges;
+    Eigen::MatrixXd reference_field;
+    Eigen::VectorXd theta;
+    Eigen::MatrixXd kappa;
+    Eigen::MatrixXi period_jump;
+};
+
+inline Eigen::MatrixXi generate_edge_matrix(const std::vector<VertexEdge>& edges)
+{
+    int num_edges = edges.size();
+    Eigen::MatrixXi E(num_edges, 2);
+    for (int eij = 0; eij < num_edges; ++eij) {
+        E(eij, 0) = edges[eij][0];
+        E(eij, 1) = edges[eij][1];
+    }
+    return E;
+}
+
+template <typename Derived>
+std::vector<VertexEdge> generate_edge_list(const Eigen::MatrixBase<Derived>& E)
+{
+    int num_edges = E.rows();
+    std::vector<VertexEdge> edges(num_edges);
+    for (int eij = 0; eij < num_edges; ++eij) {
+        edges[eij][0] = E(eij, 0);
+        edges[eij][1] = E(eij, 1);
+    }
+    return edges;
+}
+
+/**
+ * @brief Write preprocessed feature and field data to a binary cache file.
+ *
+ * The cache is written to a temporary file first so that an interrupted write does not leave
+ * a truncated cache.
+ *
+ * @param cache_filename: path for the cache file
+ * @param key: hash of the input mesh and preprocessing parameters the data was generated from
+ * @param data: preprocessed data to cache
+ * @return true iff the cache was written
+ */
+inline bool write_field_cache(
+    const std::string& cache_filename,
+    uint64_t key,
+    const FeatureFieldData& data)
+{
+    BinaryWriter writer(FIELD_CACHE_VERSION, key);
+    writer.add("V", data.V);
+    writer.add("F", data.F);
+    writer.add("feature_edges", generate_edge_matrix(data.feature_edges));
+    writer.add("hard_feature_edges", generate_edge_matrix(data.hard_feature_edges));
+    writer.add("reference_field", data.reference_field);
+    writer.add("theta", data.theta);
+    writer.add("kappa", data.kappa);
+    writer.add("period_jump", data.period_jump);
+
+    std::string temp_filename = cache_filename + ".tmp";
+    if (!writer.write(temp_filename)) return false;
+    std::error_code error_code;
+    std::filesystem::rename(temp_filename, cache_filename, error_code);
+    return !error_code;
+}
+
+/**
+ * @brief Load preprocessed feature and field data from a binary cache file.
+ *
+ * The cache is only used if its version is current and its key matches the given key.
+ *
+ * @param cache_filename: path of the cache file
+ * @param key: hash of the current input mesh and preprocessing parameters
+ * @param data: loaded preprocessed data
+ * @return true iff a valid cache was loaded
+ */
+inline bool load_field_cache(const std::string& cache_filename, uint64_t key, FeatureFieldData& data)
+{
+    BinaryReader reader(cache_filename);
+    if (!reader.is_valid()) return false;
+    if (reader.version() != FIELD_CACHE_VERSION) {
+        spdlog::info("Ignoring cache {} with outdated version {}", cache_filename, reader.version());
+        return false;
+    }
+    if (reader.key() != key) {
+        spdlog::info("Ignoring cache {} for a different input mesh or preprocessing", cache_filename);
+        return false;
+    }
+    for (std::string name : {"V", "F", "feature_edges", "hard_feature_edges", "reference_field",
+                             "theta", "kappa", "period_jump"}) {
+        if (!reader.has(name)) {
+            spdlog::warn("Cache {} is missing {}", cache_filename, name);
+            return false;
+        }
+    }
+
+    data.V = reader.get<double>("V");
+    data.F = reader.get<int>("F");
+    data.feature_edges = generate_edge_list(reader.get<int>("feature_edges"));
+    data.hard_feature_edges = generate_edge_list(reader.get<int>("hard_feature_edges"));
+    data.reference_field = reader.get<double>("reference_field");
+    data.theta = reader.get<double>("theta");
+    data.kappa = reader.get<double>("kappa");
+    data.period_jump = reader.get<int>("period_jump");
+    return true;
+}
+
+} // namespace Penner
@@ -7,11 +7,13 @@
 
 #include "util/vf_mesh.h"
 
-#include <igl/readOBJ.h>
-#include <igl/writeOBJ.h>
-#include <igl/facet_components.h>
-#include <igl/remove_unreferenced.h>
+#include "components.h"
+#include "halfedge_connectivity.h"
+#include "obj_io.h"
+#include "output_bundle.h"
 #include <CLI/CLI.hpp>
+
+#include <atomic>
 #ifdef ENABLE_VISUALIZATION
 #include "polyscope/surface_mesh.h"
 #include "polyscope/point_cloud.h"
@@ -27,67 +29,70 @@ using namespace Penner::Feature;
 int main(int argc, char* argv[])
 {
     // Get command line arguments
-    CLI::App app{"View a quad mesh"};
+    CLI::App app{"Split a parameterized mesh into its layout components"};
     std::string mesh_filename = "";
+    std::string output_dir = "./";
+    bool packed = false;
 
     // IO Parameters
-    app.add_option("--mesh", mesh_filename, "Mesh filepath")->check(CLI::ExistingFile)->required();
+    app.add_option("--mesh", mesh_filename, "Mesh filepath (obj or output bundle)")->check(CLI::ExistingFile)->required();
+    app.add_option("--output", output_dir, "Output directory");
+    app.add_flag("--packed", packed, "Write all components to a single packed binary file");
     CLI11_PARSE(app, argc, argv);
 
     spdlog::set_level(spdlog::level::debug);
+    std::filesystem::create_directory(output_dir);
 
     // Get input mesh
     Eigen::MatrixXd V, uv, N;
     Eigen::MatrixXi F, FT, FN;
     spdlog::info("Using mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, uv, N, F, FT, FN);
-
-    std::vector<VertexEdge> E = load_mesh_edges(mesh_filename);
-
-    Eigen::MatrixXi F_is_seam = find_seams(F, FT);
-    auto [V_seams, E_seams] = generate_edges(V, F, F_is_seam);
+    if (is_output_bundle(mesh_filename)) {
+        RefinedParameterization parameterization;
+        Eigen::MatrixXi is_cone_corner;
+        if (!load_output_bundle(mesh_filename, parameterization, is_cone_corner)) return 1;
+        V = std::move(parameterization.V);
+        F = std::move(parameterization.F);
+        uv = std::move(parameterization.uv);
+        FT = std::move(parameterization.FT);
+    } else {
+        if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) return 1;
+    }
 
     // get components of layout
-    Eigen::VectorXi components;
-    igl::facet_components(FT, components);
-    int num_components = components.maxCoeff() + 1;
-    std::vector<std::vector<int>> component_faces(num_components, std::vector<int>({}));
-    int num_faces = F.rows();
-    for (int fi = 0; fi < num_faces; ++fi)
+    HalfedgeConnectivity layout_connectivity = build_halfedge_connectivity(FT, uv.rows());
+    spdlog::debug("Built layout connectivity for {} halfedges", layout_connectivity.num_halfedges());
+    int num_components;
+    Eigen::VectorXi components = compute_face_components(layout_connectivity, num_components);
+    spdlog::info("Splitting mesh into {} components", num_components);
+
+    // write all components to a single file
+    if (packed)
     {
-        int ci = components[fi];
-        component_faces[ci].push_back(fi);
+        std::string output_filename = (std::filesystem::path(output_dir) / "components.bin").string();
+        return (write_packed_components(output_filename, V, F, uv, FT, components, num_components)) ? 0 : 1;
     }
 
-    for (int ci = 0; ci < num_components; ++ci)
-    {
-        int num_component_faces = component_faces[ci].size();
-        Eigen::MatrixXi Fc(num_component_faces, 3);
-        Eigen::MatrixXi FTc(num_component_faces, 3);
-        for (int i = 0; i < num_component_faces; ++i)
-        {
-            int fi = component_faces[ci][i];
-            Fc.row(i) = F.row(fi);
-            FTc.row(i) = FT.row(fi);
-        }
-        Eigen::MatrixXi NF, NFT, NFN, TF;
-        Eigen::MatrixXd NV, Nuv, NN, TV;
-        Eigen::VectorXi I, J;
-        igl::remove_unreferenced(V, Fc, NV, NF, I, J);
-        igl::remove_unreferenced(uv, FTc, Nuv, NFT, I, J);
+    // write each component and its layout as it is extracted
+    std::atomic<bool> is_written(true);
+    auto write_component = [&](int ci, const MeshComponent& component) {
+        // components are already written in parallel
+        set_num_threads(1);
 
-        int num_component_vertices = Nuv.rows();
+        int num_component_vertices = component.uv.rows();
         Eigen::MatrixXd uv_embed = Eigen::MatrixXd::Zero(num_component_vertices, 3);
-        for (int vi = 0; vi < num_component_vertices; ++vi)
-        {
-            uv_embed(vi, 0) = Nuv(vi, 0);
-            uv_embed(vi, 1) = Nuv(vi, 1);
-        }
+        uv_embed.leftCols(2) = component.uv.leftCols(2);
 
-        spdlog::info("{}", Nuv);
-        std::string output_filename = "component_" + std::to_string(ci) + ".obj";
-        igl::writeOBJ(output_filename, NV, NF, NN, NFN, Nuv, NFT);
-        output_filename = "layout_" + std::to_string(ci) + ".obj";
-        igl::writeOBJ(output_filename, uv_embed, NFT, NN, NFN, Nuv, NFT);
-    }
+        spdlog::debug("Writing component {} with {} faces", ci, component.F.rows());
+        std::string output_filename = (std::filesystem::path(output_dir) / ("component_" + std::to_string(ci) + ".obj")).string();
+        if (!write_obj_mesh(output_filename, component.V, component.F, component.uv, component.FT)) {
+            is_written = false;
+        }
+        output_filename = (std::filesystem::path(output_dir) / ("layout_" + std::to_string(ci) + ".obj")).string();
+        if (!write_obj_mesh(output_filename, uv_embed, component.FT, component.uv, component.FT)) {
+            is_written = false;
+        }
+    };
+    extract_components(V, F, uv, FT, components, num_components, write_component);
+    return (is_written) ? 0 : 1;
 }
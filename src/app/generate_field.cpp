@@ -8,9 +8,8 @@
 #include "field/frame_field.h"
 #include "holonomy/core/viewer.h"
 #include <igl/bounding_box_diagonal.h>
-#include <igl/writeOBJ.h>
 
-#include <igl/readOBJ.h>
+#include "obj_io.h"
 #include <CLI/CLI.hpp>
 
 #ifdef ENABLE_VISUALIZATION
@@ -49,7 +48,7 @@ int main(int argc, char* argv[])
     Eigen::MatrixXd V, uv, N;
     Eigen::MatrixXi F, FT, FN;
     spdlog::info("optimizing mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, uv, N, F, FT, FN);
+    if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) return 1;
 
     // refine input mesh
     std::vector<VertexEdge> feature_edges, hard_feature_edges;
@@ -139,7 +138,7 @@ int main(int argc, char* argv[])
                 view_seamless_parameterization(V_r, F_r, uv_r, FT_r, "refined mesh", false);
 
                 std::string output_filename = join_path(output_dir, mesh+"_param.obj");
-                write_obj_with_uv(output_filename, V_r, F_r, uv_r, FT_r);
+                write_obj_mesh(output_filename, V_r, F_r, uv_r, FT_r);
             }
             if (ImGui::Button("write field")) {
                 field_generator.get_field(marked_metric, vtx_reindex, F_cut, face_reindex, reference_corner, theta, kappa, period_jump);
@@ -156,7 +155,7 @@ int main(int argc, char* argv[])
     // write output
     std::string output_filename;
     output_filename = join_path(output_dir, mesh + ".obj");
-    igl::writeOBJ(output_filename, V, F);
+    write_obj_mesh(output_filename, V, F);
     output_filename = join_path(output_dir, mesh + "_features");
     write_feature_edges(output_filename, feature_edges);
     output_filename = join_path(output_dir, mesh + "_hard_features");
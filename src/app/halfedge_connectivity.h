@@ -0,0 +1,205 @@
+#pragma once
+
+#include "parallel.h"
+#include "profiler.h"
+
+#include <Eigen/Core>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Penner {
+
+/**
+ * @brief Lock free union find that supports concurrent unions.
+ *
+ * Roots are always linked below the smaller root with a compare and swap, so the root of each
+ * set is its minimum element and the final partition does not depend on the order of unions.
+ */
+class ConcurrentUnionFind
+{
+public:
+    ConcurrentUnionFind(int num_elements)
+        : m_num_elements(num_elements)
+        , m_parent(new std::atomic<int>[num_elements])
+    {
+        parallel_for(num_elements, [&](int64_t i) { m_parent[i].store(i, std::memory_order_relaxed); });
+    }
+
+    int find(int i) const
+    {
+        while (true) {
+            int parent = m_parent[i].load(std::memory_order_relaxed);
+            if (parent == i) return i;
+
+            // path halving, where a failed update only loses compression
+            int grandparent = m_parent[parent].load(std::memory_order_relaxed);
+            if (parent != grandparent) {
+                m_parent[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            }
+            i = grandparent;
+        }
+    }
+
+    void union_sets(int i, int j)
+    {
+        while (true) {
+            i = find(i);
+            j = find(j);
+            if (i == j) return;
+            if (i < j) std::swap(i, j);
+
+            // link the larger root below the smaller root if it is still a root
+            int expected = i;
+            if (m_parent[i].compare_exchange_strong(expected, j, std::memory_order_relaxed)) return;
+        }
+    }
+
+    /**
+     * @brief Label each element by the index of its set, with sets ordered by minimum element.
+     *
+     * @param num_sets: number of sets
+     * @return per element set index
+     */
+    std::vector<int> index_sets(int& num_sets) const
+    {
+        std::vector<int> roots(m_num_elements);
+        parallel_for(m_num_elements, [&](int64_t i) { roots[i] = find(i); });
+
+        // roots are the minimum elements of their sets, so they are labeled before use
+        std::vector<int> set_index(m_num_elements);
+        num_sets = 0;
+        for (int i = 0; i < m_num_elements; ++i) {
+            set_index[i] = (roots[i] == i) ? num_sets++ : set_index[roots[i]];
+        }
+        return set_index;
+    }
+
+private:
+    int m_num_elements;
+    std::unique_ptr<std::atomic<int>[]> m_parent;
+};
+
+/**
+ * @brief Compact halfedge connectivity of a triangle mesh, stored as arrays of 32 bit indices.
+ *
+ * Halfedge 3 * f + i is the edge from F(f, i) to F(f, (i + 1) % 3), as for the edge indexing
+ * of igl::triangle_triangle_adjacency, so next, prev and face are implicit and only the tail
+ * and opposite halfedge are stored. Outgoing halfedges are also grouped by tail vertex.
+ */
+struct HalfedgeConnectivity
+{
+    int num_vertices = 0;
+    int num_faces = 0;
+    std::vector<int32_t> tail; // per halfedge tail vertex
+    std::vector<int32_t> opposite; // per halfedge opposite halfedge, or -1 on the boundary
+    std::vector<int32_t> out_offsets; // per vertex offset of its outgoing halfedges
+    std::vector<int32_t> out_halfedges; // halfedges sorted by tail vertex
+
+    int num_halfedges() const { return 3 * num_faces; }
+    static int face(int h) { return h / 3; }
+    static int next(int h) { return (h % 3 == 2) ? h - 2 : h + 1; }
+    static int prev(int h) { return (h % 3 == 0) ? h + 2 : h - 1; }
+    int tip(int h) const { return tail[next(h)]; }
+    bool is_boundary(int h) const { return opposite[h] < 0; }
+};
+
+/**
+ * @brief Build the halfedge connectivity of a triangle mesh.
+ *
+ * Outgoing halfedges are bucketed by vertex with a counting sort, and the opposite halfedges
+ * are then found in parallel without per face allocation. For nonmanifold edges, the first
+ * matching halfedge is used.
+ *
+ * @param F: mesh faces
+ * @param num_vertices: number of mesh vertices
+ * @return halfedge connectivity
+ */
+inline HalfedgeConnectivity build_halfedge_connectivity(const Eigen::MatrixXi& F, int num_vertices)
+{
+    ScopedTimer timer("build_halfedge_connectivity", "connectivity");
+    HalfedgeConnectivity connectivity;
+    connectivity.num_vertices = num_vertices;
+    connectivity.num_faces = F.rows();
+    int num_halfedges = connectivity.num_halfedges();
+
+    // bucket halfedges by tail vertex
+    std::vector<int32_t>& tail = connectivity.tail;
+    std::vector<int32_t>& out_offsets = connectivity.out_offsets;
+    std::vector<int32_t>& out_halfedges = connectivity.out_halfedges;
+    tail.resize(num_halfedges);
+    out_offsets.assign(num_vertices + 1, 0);
+    for (int h = 0; h < num_halfedges; ++h) {
+        tail[h] = F(h / 3, h % 3);
+        ++out_offsets[tail[h] + 1];
+    }
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        out_offsets[vi + 1] += out_offsets[vi];
+    }
+    std::vector<int32_t> position(out_offsets.begin(), out_offsets.end() - 1);
+    out_halfedges.resize(num_halfedges);
+    for (int h = 0; h < num_halfedges; ++h) {
+        out_halfedges[position[tail[h]]++] = h;
+    }
+
+    // find the opposite halfedge among the halfedges leaving the tip
+    connectivity.opposite.assign(num_halfedges, -1);
+    parallel_for(num_halfedges, [&](int64_t h) {
+        int vi = tail[h];
+        int vj = connectivity.tip(h);
+        for (int k = out_offsets[vj]; k < out_offsets[vj + 1]; ++k) {
+            int h_opp = out_halfedges[k];
+            if (connectivity.tip(h_opp) == vi) {
+                connectivity.opposite[h] = h_opp;
+                break;
+            }
+        }
+    });
+
+    return connectivity;
+}
+
+/**
+ * @brief Compute the connected components of the faces of a mesh across shared edges.
+ *
+ * Faces are connected across every edge they share, regardless of orientation, so layouts
+ * with inconsistently oriented or nonmanifold edges are not split along them. Components are
+ * labeled in order of their first face.
+ *
+ * @param connectivity: mesh halfedge connectivity
+ * @param num_components: number of components
+ * @return per face component index
+ */
+inline Eigen::VectorXi compute_face_components(
+    const HalfedgeConnectivity& connectivity,
+    int& num_components)
+{
+    int num_faces = connectivity.num_faces;
+    ConcurrentUnionFind face_components(num_faces);
+    parallel_for(connectivity.num_halfedges(), [&](int64_t h) {
+        int f = HalfedgeConnectivity::face(h);
+        int vi = connectivity.tail[h];
+        int vj = connectivity.tip(h);
+
+        // union with faces of oppositely oriented halfedges, leaving the tip
+        for (int k = connectivity.out_offsets[vj]; k < connectivity.out_offsets[vj + 1]; ++k) {
+            int h_opp = connectivity.out_halfedges[k];
+            if (connectivity.tip(h_opp) != vi) continue;
+            face_components.union_sets(f, HalfedgeConnectivity::face(h_opp));
+        }
+
+        // union with faces of equally oriented halfedges, leaving the tail
+        for (int k = connectivity.out_offsets[vi]; k < connectivity.out_offsets[vi + 1]; ++k) {
+            int h_twin = connectivity.out_halfedges[k];
+            if ((h_twin == h) || (connectivity.tip(h_twin) != vj)) continue;
+            face_components.union_sets(f, HalfedgeConnectivity::face(h_twin));
+        }
+    });
+
+    std::vector<int> set_index = face_components.index_sets(num_components);
+    return Eigen::Map<Eigen::VectorXi>(set_index.data(), num_faces);
+}
+
+} // namespace Penner
@@ -7,7 +7,7 @@
 #include "holonomy/field/frame_field.h"
 #include "holonomy/core/viewer.h"
 
-#include <igl/readOBJ.h>
+#include "obj_io.h"
 #include <CLI/CLI.hpp>
 
 using namespace Penner;
@@ -37,7 +37,7 @@ int main(int argc, char* argv[])
     Eigen::MatrixXd V, uv, N;
     Eigen::MatrixXi F, FT, FN;
     spdlog::info("optimizing mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, uv, N, F, FT, FN);
+    if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) return 1;
 
     // Get features and field
     std::vector<VertexEdge> feature_edges, hard_feature_edges;
@@ -0,0 +1,535 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Penner {
+
+// Chunked parallel reader and writer for obj meshes
+//
+// The file is split into chunks at line boundaries that are parsed independently and then
+// merged with prefix sums over the element counts of each chunk. Floating point values are
+// parsed and formatted with from_chars/to_chars, which round trip doubles exactly, or with
+// strtod and 17 digit printf on standard libraries without floating point charconv. The
+// supported subset matches the Eigen interface of igl::readOBJ and igl::writeOBJ: vertex,
+// texture and normal coordinates and polygonal faces of a fixed size with "v", "v/t", "v//n"
+// or "v/t/n" corners, including negative relative indices.
+
+/**
+ * @brief Elements parsed from a contiguous chunk of an obj file
+ */
+struct ObjChunk
+{
+    // coordinates, stored row major
+    std::vector<double> V, uv, N;
+    int V_cols = -1, uv_cols = -1, N_cols = -1;
+    int64_t num_V = 0, num_uv = 0, num_N = 0;
+
+    // zero based face indices, stored row major
+    std::vector<int> F, FT, FN;
+    int face_size = -1;
+    int64_t num_faces = 0, num_textured_faces = 0, num_normal_faces = 0;
+
+    // positions of relative indices that are only local to the chunk
+    std::vector<int64_t> relative_F, relative_FT, relative_FN;
+
+    std::string error = "";
+};
+
+inline const char* skip_obj_whitespace(const char* p, const char* end)
+{
+    while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) ++p;
+    return p;
+}
+
+// floating point from_chars/to_chars are missing from some standard libraries, including
+// Apple libc++, which do not define the full feature test macro
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+#define PENNER_FLOAT_CHARCONV 1
+#endif
+
+// parse a double at p, returning the end of the parsed value or nullptr if there is none
+inline const char* parse_obj_double(const char* p, const char* end, double& value)
+{
+#ifdef PENNER_FLOAT_CHARCONV
+    auto [next, ec] = std::from_chars(p, end, value);
+    return (ec == std::errc()) ? next : nullptr;
+#else
+    // copy the token to a null terminated buffer, as the chunk is not terminated
+    char buffer[64];
+    size_t length = 0;
+    while ((p + length < end) && (length + 1 < sizeof(buffer)) && (p[length] != ' ') &&
+           (p[length] != '\t') && (p[length] != '\r') && (p[length] != '#')) {
+        buffer[length] = p[length];
+        ++length;
+    }
+    buffer[length] = '\0';
+    char* next;
+    value = std::strtod(buffer, &next);
+    return (next == buffer) ? nullptr : p + (next - buffer);
+#endif
+}
+
+// parse the coordinates of a v, vt, or vn line into a row major array, checking the row size
+inline void parse_obj_coordinates(
+    const char* p,
+    const char* end,
+    std::vector<double>& X,
+    int& cols,
+    int64_t& rows,
+    std::string& error)
+{
+    int count = 0;
+    while (true) {
+        p = skip_obj_whitespace(p, end);
+        if ((p == end) || (*p == '#')) break;
+        if (*p == '+') ++p;
+        double value;
+        const char* next = parse_obj_double(p, end, value);
+        if (next == nullptr) {
+            error = "invalid coordinate " + std::string(p, end);
+            return;
+        }
+        X.push_back(value);
+        p = next;
+        ++count;
+    }
+
+    if (cols < 0) cols = count;
+    if (count != cols) {
+        error = "inconsistent coordinate dimensions " + std::to_string(count) + " and " +
+                std::to_string(cols);
+        return;
+    }
+    ++rows;
+}
+
+// parse a one based, possibly negative, index and convert it to a zero based index
+inline const char* parse_obj_index(
+    const char* p,
+    const char* end,
+    int64_t num_local,
+    std::vector<int>& indices,
+    std::vector<int64_t>& relative_indices,
+    std::string& error)
+{
+    if ((p < end) && (*p == '+')) ++p;
+    int index;
+    auto [next, ec] = std::from_chars(p, end, index);
+    if ((ec != std::errc()) || (index == 0)) {
+        error = "invalid face index " + std::string(p, end);
+        return end;
+    }
+
+    // relative indices are resolved to chunk local indices here and offset when merging
+    if (index < 0) {
+        relative_indices.push_back(indices.size());
+        indices.push_back(num_local + index);
+    } else {
+        indices.push_back(index - 1);
+    }
+
+    return next;
+}
+
+inline void parse_obj_face(const char* p, const char* end, ObjChunk& chunk)
+{
+    int count = 0, num_textured = 0, num_normal = 0;
+    while (true) {
+        p = skip_obj_whitespace(p, end);
+        if ((p == end) || (*p == '#')) break;
+        p = parse_obj_index(p, end, chunk.num_V, chunk.F, chunk.relative_F, chunk.error);
+        if ((p < end) && (*p == '/')) {
+            ++p;
+            if ((p < end) && (*p != '/')) {
+                p = parse_obj_index(p, end, chunk.num_uv, chunk.FT, chunk.relative_FT, chunk.error);
+                ++num_textured;
+            }
+            if ((p < end) && (*p == '/')) {
+                ++p;
+                p = parse_obj_index(p, end, chunk.num_N, chunk.FN, chunk.relative_FN, chunk.error);
+                ++num_normal;
+            }
+        }
+        if (!chunk.error.empty()) return;
+        ++count;
+    }
+
+    // check face is consistent with previous faces
+    if (chunk.face_size < 0) chunk.face_size = count;
+    if (count != chunk.face_size) {
+        chunk.error = "inconsistent face sizes " + std::to_string(count) + " and " +
+                      std::to_string(chunk.face_size);
+        return;
+    }
+    if (((num_textured > 0) && (num_textured != count)) ||
+        ((num_normal > 0) && (num_normal != count))) {
+        chunk.error = "face with partial texture or normal indices";
+        return;
+    }
+    ++chunk.num_faces;
+    if (num_textured > 0) ++chunk.num_textured_faces;
+    if (num_normal > 0) ++chunk.num_normal_faces;
+}
+
+inline void parse_obj_chunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    while ((p < end) && (chunk.error.empty())) {
+        const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (line_end == nullptr) line_end = end;
+
+        // dispatch on the line type, ignoring unsupported elements
+        p = skip_obj_whitespace(p, line_end);
+        if ((line_end - p >= 2) && (p[0] == 'v') && ((p[1] == ' ') || (p[1] == '\t'))) {
+            parse_obj_coordinates(p + 2, line_end, chunk.V, chunk.V_cols, chunk.num_V, chunk.error);
+        } else if ((line_end - p >= 3) && (p[0] == 'v') && (p[1] == 't') && ((p[2] == ' ') || (p[2] == '\t'))) {
+            parse_obj_coordinates(p + 3, line_end, chunk.uv, chunk.uv_cols, chunk.num_uv, chunk.error);
+        } else if ((line_end - p >= 3) && (p[0] == 'v') && (p[1] == 'n') && ((p[2] == ' ') || (p[2] == '\t'))) {
+            parse_obj_coordinates(p + 3, line_end, chunk.N, chunk.N_cols, chunk.num_N, chunk.error);
+        } else if ((line_end - p >= 2) && (p[0] == 'f') && ((p[1] == ' ') || (p[1] == '\t'))) {
+            parse_obj_face(p + 2, line_end, chunk);
+        }
+
+        p = line_end + 1;
+    }
+}
+
+// get the common column count of the chunks, or -2 if they are inconsistent
+inline int merge_obj_cols(const std::vector<int>& chunk_cols)
+{
+    int cols = -1;
+    for (int chunk_col : chunk_cols) {
+        if (chunk_col < 0) continue;
+        if ((cols >= 0) && (chunk_col != cols)) return -2;
+        cols = chunk_col;
+    }
+    return cols;
+}
+
+// copy row major chunk data into a column major matrix in parallel
+template <typename T>
+void merge_obj_chunks(
+    const std::vector<ObjChunk>& chunks,
+    const std::vector<int64_t>& row_offsets,
+    const std::vector<int64_t>& index_offsets,
+    int cols,
+    std::vector<T> ObjChunk::*chunk_data,
+    std::vector<int64_t> ObjChunk::*chunk_relative,
+    Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& X)
+{
+    int num_chunks = chunks.size();
+    X.resize(row_offsets.back(), std::max(cols, 0));
+    parallel_for(num_chunks, [&](int64_t c) {
+        const std::vector<T>& data = chunks[c].*chunk_data;
+
+        // only copy the chunk data if it has relative indices to offset
+        bool has_relative = ((chunk_relative != nullptr) && (!(chunks[c].*chunk_relative).empty()));
+        std::vector<T> local_data;
+        if (has_relative) {
+            local_data = data;
+            for (int64_t i : chunks[c].*chunk_relative) {
+                local_data[i] += index_offsets[c];
+            }
+        }
+        const std::vector<T>& row_data = (has_relative) ? local_data : data;
+        int64_t num_rows = (cols > 0) ? (row_data.size() / cols) : 0;
+        for (int64_t i = 0; i < num_rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                X(row_offsets[c] + i, j) = row_data[i * cols + j];
+            }
+        }
+    });
+}
+
+/**
+ * @brief Read an obj mesh with vertex, texture, and normal coordinates in parallel.
+ *
+ * Drop in replacement for the Eigen interface of igl::readOBJ. Texture (resp. normal) face
+ * indices are only returned if every face has them, and are empty otherwise.
+ *
+ * @param filename: path of the obj file
+ * @param V: vertex positions
+ * @param uv: texture coordinates
+ * @param N: normal coordinates
+ * @param F: face vertex indices
+ * @param FT: face texture indices
+ * @param FN: face normal indices
+ * @return true iff the mesh was read successfully
+ */
+inline bool load_obj_mesh(
+    const std::string& filename,
+    Eigen::MatrixXd& V,
+    Eigen::MatrixXd& uv,
+    Eigen::MatrixXd& N,
+    Eigen::MatrixXi& F,
+    Eigen::MatrixXi& FT,
+    Eigen::MatrixXi& FN)
+{
+    // read entire file
+    std::ifstream input_file(filename, std::ios::binary | std::ios::ate);
+    if (!input_file) {
+        spdlog::error("Could not open {}", filename);
+        return false;
+    }
+    int64_t file_size = input_file.tellg();
+    std::vector<char> buffer(file_size);
+    input_file.seekg(0);
+    input_file.read(buffer.data(), file_size);
+    if (input_file.gcount() != file_size) {
+        spdlog::error("Could not read {}", filename);
+        return false;
+    }
+
+    // split the file at line boundaries into chunks of roughly equal size
+    int num_chunks = std::max<int64_t>(std::min<int64_t>(get_num_threads(), file_size >> 16), 1);
+    std::vector<int64_t> chunk_starts(num_chunks + 1, file_size);
+    chunk_starts[0] = 0;
+    for (int c = 1; c < num_chunks; ++c) {
+        int64_t start = std::max((file_size * c) / num_chunks, chunk_starts[c - 1]);
+        while ((start < file_size) && (buffer[start - 1] != '\n')) ++start;
+        chunk_starts[c] = start;
+    }
+
+    // parse chunks in parallel
+    std::vector<ObjChunk> chunks(num_chunks);
+    parallel_for_blocks(num_chunks, num_chunks, [&](int c, int64_t, int64_t) {
+        parse_obj_chunk(
+            buffer.data() + chunk_starts[c],
+            buffer.data() + chunk_starts[c + 1],
+            chunks[c]);
+    });
+    for (const auto& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            spdlog::error("Could not parse {}: {}", filename, chunk.error);
+            return false;
+        }
+    }
+
+    // check dimensions are consistent across chunks
+    std::vector<int> V_cols, uv_cols, N_cols, face_sizes;
+    int64_t num_faces = 0, num_textured_faces = 0, num_normal_faces = 0;
+    for (const auto& chunk : chunks) {
+        V_cols.push_back(chunk.V_cols);
+        uv_cols.push_back(chunk.uv_cols);
+        N_cols.push_back(chunk.N_cols);
+        face_sizes.push_back(chunk.face_size);
+        num_faces += chunk.num_faces;
+        num_textured_faces += chunk.num_textured_faces;
+        num_normal_faces += chunk.num_normal_faces;
+    }
+    int V_dim = merge_obj_cols(V_cols);
+    int uv_dim = merge_obj_cols(uv_cols);
+    int N_dim = merge_obj_cols(N_cols);
+    int face_size = merge_obj_cols(face_sizes);
+    if ((V_dim < -1) || (uv_dim < -1) || (N_dim < -1) || (face_size < -1)) {
+        spdlog::error("Could not parse {}: inconsistent element dimensions", filename);
+        return false;
+    }
+    bool has_FT = ((num_faces > 0) && (num_textured_faces == num_faces));
+    bool has_FN = ((num_faces > 0) && (num_normal_faces == num_faces));
+    if ((num_textured_faces > 0) && (!has_FT)) {
+        spdlog::warn("Ignoring texture indices of {}: not every face is textured", filename);
+    }
+    if ((num_normal_faces > 0) && (!has_FN)) {
+        spdlog::warn("Ignoring normal indices of {}: not every face has normals", filename);
+    }
+
+    // compute global offsets of the elements in each chunk
+    std::vector<int64_t> V_offsets(num_chunks + 1, 0), uv_offsets(num_chunks + 1, 0),
+        N_offsets(num_chunks + 1, 0), F_offsets(num_chunks + 1, 0);
+    for (int c = 0; c < num_chunks; ++c) {
+        V_offsets[c + 1] = V_offsets[c] + chunks[c].num_V;
+        uv_offsets[c + 1] = uv_offsets[c] + chunks[c].num_uv;
+        N_offsets[c + 1] = N_offsets[c] + chunks[c].num_N;
+        F_offsets[c + 1] = F_offsets[c] + chunks[c].num_faces;
+    }
+
+    // merge chunks into matrices
+    merge_obj_chunks(chunks, V_offsets, V_offsets, V_dim, &ObjChunk::V, nullptr, V);
+    merge_obj_chunks(chunks, uv_offsets, uv_offsets, uv_dim, &ObjChunk::uv, nullptr, uv);
+    merge_obj_chunks(chunks, N_offsets, N_offsets, N_dim, &ObjChunk::N, nullptr, N);
+    merge_obj_chunks(chunks, F_offsets, V_offsets, face_size, &ObjChunk::F, &ObjChunk::relative_F, F);
+    if (has_FT) {
+        merge_obj_chunks(chunks, F_offsets, uv_offsets, face_size, &ObjChunk::FT, &ObjChunk::relative_FT, FT);
+    } else {
+        FT.resize(0, 0);
+    }
+    if (has_FN) {
+        merge_obj_chunks(chunks, F_offsets, N_offsets, face_size, &ObjChunk::FN, &ObjChunk::relative_FN, FN);
+    } else {
+        FN.resize(0, 0);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read an obj mesh, discarding texture and normal data.
+ *
+ * @param filename: path of the obj file
+ * @param V: vertex positions
+ * @param F: face vertex indices
+ * @return true iff the mesh was read successfully
+ */
+inline bool load_obj_mesh(const std::string& filename, Eigen::MatrixXd& V, Eigen::MatrixXi& F)
+{
+    Eigen::MatrixXd uv, N;
+    Eigen::MatrixXi FT, FN;
+    return load_obj_mesh(filename, V, uv, N, F, FT, FN);
+}
+
+inline void append_obj_value(std::string& output, double value)
+{
+    char buffer[32];
+#ifdef PENNER_FLOAT_CHARCONV
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, end);
+#else
+    int length = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    output.append(buffer, length);
+#endif
+}
+
+inline void append_obj_value(std::string& output, int value)
+{
+    char buffer[16];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, end);
+}
+
+// format the rows of a matrix in parallel blocks and write them in order
+template <typename Func>
+void write_obj_rows(std::ofstream& output_file, int64_t num_rows, const Func& format_row)
+{
+    int num_blocks = std::max<int64_t>(std::min<int64_t>(get_num_threads(), num_rows >> 10), 1);
+    std::vector<std::string> blocks(num_blocks);
+    parallel_for_blocks(num_rows, num_blocks, [&](int block, int64_t begin, int64_t end) {
+        std::string& output = blocks[block];
+        output.reserve((end - begin) * 64);
+        for (int64_t i = begin; i < end; ++i) {
+            format_row(output, i);
+        }
+    });
+    for (const auto& block : blocks) {
+        output_file.write(block.data(), block.size());
+    }
+}
+
+inline void write_obj_coordinates(
+    std::ofstream& output_file,
+    const std::string& prefix,
+    const Eigen::MatrixXd& X)
+{
+    write_obj_rows(output_file, X.rows(), [&](std::string& output, int64_t i) {
+        output.append(prefix);
+        for (int j = 0; j < X.cols(); ++j) {
+            output.push_back(' ');
+            append_obj_value(output, X(i, j));
+        }
+        output.push_back('\n');
+    });
+}
+
+/**
+ * @brief Write an obj mesh with optional normal and texture coordinates in parallel.
+ *
+ * Drop in replacement for the Eigen interface of igl::writeOBJ. Normal (resp. texture) data
+ * is only written if the face indices are nonempty.
+ *
+ * @param filename: path of the output obj file
+ * @param V: vertex positions
+ * @param F: face vertex indices
+ * @param N: normal coordinates
+ * @param FN: face normal indices
+ * @param uv: texture coordinates
+ * @param FT: face texture indices
+ * @return true iff the mesh was written successfully
+ */
+inline bool write_obj_mesh(
+    const std::string& filename,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& N,
+    const Eigen::MatrixXi& FN,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT)
+{
+    bool has_FN = (FN.size() > 0);
+    bool has_FT = (FT.size() > 0);
+    if ((has_FN && (FN.rows() != F.rows() || FN.cols() != F.cols())) ||
+        (has_FT && (FT.rows() != F.rows() || FT.cols() != F.cols()))) {
+        spdlog::error("Could not write {}: inconsistent face index dimensions", filename);
+        return false;
+    }
+
+    std::ofstream output_file(filename, std::ios::binary | std::ios::trunc);
+    if (!output_file) {
+        spdlog::error("Could not open {} for writing", filename);
+        return false;
+    }
+
+    write_obj_coordinates(output_file, "v", V);
+    if (has_FN) write_obj_coordinates(output_file, "vn", N);
+    if (has_FT) write_obj_coordinates(output_file, "vt", uv);
+    write_obj_rows(output_file, F.rows(), [&](std::string& output, int64_t i) {
+        output.push_back('f');
+        for (int j = 0; j < F.cols(); ++j) {
+            output.push_back(' ');
+            append_obj_value(output, F(i, j) + 1);
+            if (has_FT || has_FN) output.push_back('/');
+            if (has_FT) append_obj_value(output, FT(i, j) + 1);
+            if (has_FN) {
+                output.push_back('/');
+                append_obj_value(output, FN(i, j) + 1);
+            }
+        }
+        output.push_back('\n');
+    });
+
+    return static_cast<bool>(output_file);
+}
+
+/**
+ * @brief Write an obj mesh with texture coordinates.
+ *
+ * @param filename: path of the output obj file
+ * @param V: vertex positions
+ * @param F: face vertex indices
+ * @param uv: texture coordinates
+ * @param FT: face texture indices
+ * @return true iff the mesh was written successfully
+ */
+inline bool write_obj_mesh(
+    const std::string& filename,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT)
+{
+    return write_obj_mesh(filename, V, F, Eigen::MatrixXd(), Eigen::MatrixXi(), uv, FT);
+}
+
+/**
+ * @brief Write an obj mesh without texture or normal data.
+ *
+ * @param filename: path of the output obj file
+ * @param V: vertex positions
+ * @param F: face vertex indices
+ * @return true iff the mesh was written successfully
+ */
+inline bool write_obj_mesh(const std::string& filename, const Eigen::MatrixXd& V, const Eigen::MatrixXi& F)
+{
+    return write_obj_mesh(filename, V, F, Eigen::MatrixXd(), Eigen::MatrixXi(), Eigen::MatrixXd(), Eigen::MatrixXi());
+}
+
+} // namespace Penner
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "checkpoint.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace Penner {
+
+// Increment when the bundled outputs change
+constexpr uint32_t OUTPUT_BUNDLE_VERSION = 1;
+
+/**
+ * @brief Check if a file is an output bundle, as determined by its extension.
+ *
+ * @param filename: path of the file
+ * @return true iff the file has the output bundle extension
+ */
+inline bool is_output_bundle(const std::string& filename)
+{
+    return (std::filesystem::path(filename).extension() == ".bin");
+}
+
+/**
+ * @brief Write all outputs of the aligned parameterization pipeline to a single binary file.
+ *
+ * The bundle holds the refined mesh and layout, feature edges, refined field, face map and
+ * cone corners, which are otherwise written as separate text files. The arrays are streamed
+ * without intermediate copies and optionally compressed with zstd.
+ *
+ * @param filename: path for the bundle file
+ * @param key: hash of the inputs and options that produced the outputs
+ * @param parameterization: refined parameterization to write
+ * @param is_cone_corner: per corner cone mask
+ * @param compression_level: zstd compression level, or 0 for no compression
+ * @return true iff the bundle was written
+ */
+inline bool write_output_bundle(
+    const std::string& filename,
+    uint64_t key,
+    const RefinedParameterization& parameterization,
+    const Eigen::MatrixXi& is_cone_corner,
+    int compression_level)
+{
+    BinaryWriter writer(OUTPUT_BUNDLE_VERSION, key, compression_level);
+    writer.add_reference("V", parameterization.V);
+    writer.add_reference("F", parameterization.F);
+    writer.add_reference("uv", parameterization.uv);
+    writer.add_reference("FT", parameterization.FT);
+    writer.add("feature_edges", generate_edge_matrix(parameterization.feature_edges));
+    writer.add_reference("reference_field", parameterization.reference_field);
+    writer.add_reference("theta", parameterization.theta);
+    writer.add_reference("kappa", parameterization.kappa);
+    writer.add_reference("period_jump", parameterization.period_jump);
+    writer.add_reference("fn_to_f", parameterization.fn_to_f);
+    writer.add_reference("is_cone_corner", is_cone_corner);
+
+    // write to a temporary file first so that only complete bundles mark a mesh as done
+    std::string temp_filename = filename + ".tmp";
+    if (!writer.write(temp_filename)) return false;
+    std::error_code error_code;
+    std::filesystem::rename(temp_filename, filename, error_code);
+    return !error_code;
+}
+
+/**
+ * @brief Check if an output bundle was completed with the given key.
+ *
+ * @param filename: path of the bundle file
+ * @param key: hash of the inputs and options of the current run
+ * @return true iff the bundle exists and was written with the key
+ */
+inline bool is_output_bundle_complete(const std::string& filename, uint64_t key)
+{
+    if (!std::filesystem::exists(filename)) return false;
+    BinaryReader reader(filename);
+    return ((reader.is_valid()) && (reader.version() == OUTPUT_BUNDLE_VERSION) && (reader.key() == key));
+}
+
+/**
+ * @brief Mark text outputs as complete with a small file holding their key.
+ *
+ * The marker is written to a temporary file first and renamed, so it only exists if it was
+ * written completely.
+ *
+ * @param filename: path for the marker file
+ * @param key: hash of the inputs and options that produced the outputs
+ * @return true iff the marker was written
+ */
+inline bool write_completion_marker(const std::string& filename, uint64_t key)
+{
+    std::string temp_filename = filename + ".tmp";
+    {
+        std::ofstream output_file(temp_filename);
+        output_file << key << "\n";
+        if (!output_file) return false;
+    }
+    std::error_code error_code;
+    std::filesystem::rename(temp_filename, filename, error_code);
+    return !error_code;
+}
+
+/**
+ * @brief Check if text outputs were completed with the given key.
+ *
+ * @param filename: path of the marker file
+ * @param key: hash of the inputs and options of the current run
+ * @return true iff the marker exists and holds the key
+ */
+inline bool is_completion_marked(const std::string& filename, uint64_t key)
+{
+    std::ifstream input_file(filename);
+    uint64_t marked_key;
+    return ((input_file >> marked_key) && (marked_key == key));
+}
+
+/**
+ * @brief Load the outputs of the aligned parameterization pipeline from a bundle.
+ *
+ * The corner feature mask and misaligned edges are not part of the outputs and are left empty.
+ *
+ * @param filename: path of the bundle file
+ * @param parameterization: loaded refined parameterization
+ * @param is_cone_corner: loaded per corner cone mask
+ * @return true iff the bundle was loaded
+ */
+inline bool load_output_bundle(
+    const std::string& filename,
+    RefinedParameterization& parameterization,
+    Eigen::MatrixXi& is_cone_corner)
+{
+    BinaryReader reader(filename);
+    if ((!reader.is_valid()) || (reader.version() != OUTPUT_BUNDLE_VERSION)) {
+        spdlog::error("Could not load output bundle from {}", filename);
+        return false;
+    }
+    for (std::string name : {"V", "F", "uv", "FT", "feature_edges", "reference_field", "theta",
+                             "kappa", "period_jump", "fn_to_f", "is_cone_corner"}) {
+        if (!reader.has(name)) {
+            spdlog::error("Output bundle {} is missing {}", filename, name);
+            return false;
+        }
+    }
+
+    parameterization.V = reader.get<double>("V");
+    parameterization.F = reader.get<int>("F");
+    parameterization.uv = reader.get<double>("uv");
+    parameterization.FT = reader.get<int>("FT");
+    parameterization.feature_edges = generate_edge_list(reader.get<int>("feature_edges"));
+    parameterization.reference_field = reader.get<double>("reference_field");
+    parameterization.theta = reader.get<double>("theta");
+    parameterization.kappa = reader.get<double>("kappa");
+    parameterization.period_jump = reader.get<int>("period_jump");
+    parameterization.fn_to_f = reader.get<int>("fn_to_f");
+    is_cone_corner = reader.get<int>("is_cone_corner");
+    return true;
+}
+
+} // namespace Penner
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace Penner {
+
+/**
+ * @brief Get the number of cores the process may run on.
+ *
+ * On Linux, this is the size of the CPU affinity mask, further limited by a cgroup v2 CPU
+ * quota if one is set, as std::thread::hardware_concurrency ignores both. Elsewhere, it is the
+ * number of hardware threads.
+ *
+ * @return number of available cores (at least one)
+ */
+inline int get_num_available_cores()
+{
+    int num_cores = std::thread::hardware_concurrency();
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) num_cores = CPU_COUNT(&cpu_set);
+
+    // cpu.max holds the quota and period in microseconds, or "max" for no quota
+    std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+    double quota, period;
+    if ((cpu_max >> quota >> period) && (quota > 0.) && (period > 0.)) {
+        num_cores = std::min<int>(num_cores, static_cast<int>(std::ceil(quota / period)));
+    }
+#endif
+    return std::max(num_cores, 1);
+}
+
+// per thread limit on the number of threads for parallel loops (nonpositive for no limit)
+inline int& thread_budget()
+{
+    thread_local int budget = 0;
+    return budget;
+}
+
+/**
+ * @brief Get the number of threads available to the current thread for parallel loops.
+ *
+ * Defaults to the number of available cores unless limited with set_num_threads.
+ *
+ * @return number of threads
+ */
+inline int get_num_threads()
+{
+    if (thread_budget() > 0) return thread_budget();
+    static const int num_available_cores = get_num_available_cores();
+    return num_available_cores;
+}
+
+/**
+ * @brief Limit the number of threads used by parallel loops launched from the current thread.
+ *
+ * @param num_threads: number of threads, or nonpositive to use all available cores
+ */
+inline void set_num_threads(int num_threads)
+{
+    thread_budget() = num_threads;
+}
+
+/**
+ * @brief Split a range of items into contiguous blocks and process the blocks in parallel.
+ *
+ * The function is called as func(block, begin, end) for each block. Blocks are contiguous and
+ * ordered, so results written per block can be concatenated deterministically. If any block
+ * throws, all blocks are still joined and the exception of the first failed block is rethrown
+ * on the calling thread.
+ *
+ * @param num_items: number of items in the range
+ * @param num_blocks: number of blocks to split the range into
+ * @param func: function to process a block of items
+ */
+template <typename Func>
+void parallel_for_blocks(int64_t num_items, int num_blocks, const Func& func)
+{
+    num_blocks = std::max<int>(std::min<int64_t>(num_blocks, num_items), 1);
+    if (num_blocks == 1) {
+        func(0, int64_t(0), num_items);
+        return;
+    }
+
+    // catch exceptions per block, as an exception escaping a thread terminates the process
+    std::vector<std::exception_ptr> exceptions(num_blocks);
+    auto run_block = [&func, &exceptions, num_items, num_blocks](int block) {
+        int64_t begin = (num_items * block) / num_blocks;
+        int64_t end = (num_items * (block + 1)) / num_blocks;
+        try {
+            func(block, begin, end);
+        } catch (...) {
+            exceptions[block] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_blocks - 1);
+    for (int block = 1; block < num_blocks; ++block) {
+        try {
+            threads.emplace_back(run_block, block);
+        } catch (const std::system_error&) {
+            // run the block on the calling thread if no thread can be started
+            run_block(block);
+        }
+    }
+    run_block(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& exception : exceptions) {
+        if (exception) std::rethrow_exception(exception);
+    }
+}
+
+/**
+ * @brief Apply a function to each index in a range in parallel.
+ *
+ * @param num_items: number of items in the range
+ * @param func: function called as func(i) for each index i
+ */
+template <typename Func>
+void parallel_for(int64_t num_items, const Func& func)
+{
+    parallel_for_blocks(num_items, get_num_threads(), [&](int, int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            func(i);
+        }
+    });
+}
+
+/**
+ * @brief Apply a function to each index in a range in parallel with dynamic scheduling.
+ *
+ * Indices are claimed one at a time from a shared counter, which balances the load when the
+ * cost per item varies greatly. The function is called as func(i, thread) with the index of the
+ * thread processing the item so that per thread workspaces can be reused.
+ *
+ * @param num_items: number of items in the range
+ * @param func: function to process a single item
+ */
+template <typename Func>
+void parallel_for_dynamic(int64_t num_items, const Func& func)
+{
+    std::atomic<int64_t> next_item(0);
+    parallel_for_blocks(get_num_threads(), get_num_threads(), [&](int thread, int64_t, int64_t) {
+        while (true) {
+            int64_t i = next_item++;
+            if (i >= num_items) break;
+            func(i, thread);
+        }
+    });
+}
+
+} // namespace Penner
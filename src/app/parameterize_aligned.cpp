@@ -1,4 +1,3 @@
-#include <igl/readOBJ.h>
 #include "feature/interface.h"
 #include "feature/core/io.h"
 #include "field/frame_field.h"
@@ -7,16 +6,33 @@
 #include "holonomy/core/viewer.h"
 #include "feature/surgery/cut_metric_generator.h"
 #include "util/vf_mesh.h"
+#include "batch.h"
+#include "checkpoint.h"
+#include "cone_corners.h"
+#include "field_cache.h"
+#include "halfedge_connectivity.h"
+#include "obj_io.h"
+#include "output_bundle.h"
+#include "profiler.h"
 
 #include <CLI/CLI.hpp>
-#include <igl/triangle_triangle_adjacency.h>
 #include <igl/bounding_box_diagonal.h>
-#include <igl/internal_angles.h>
+
+#include <memory>
 
 #ifdef ENABLE_VISUALIZATION
 #include "polyscope/surface_mesh.h"
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// revision of the optimization library, set by the build to invalidate caches when it changes
+#ifndef PENNER_LIBRARY_REVISION
+#define PENNER_LIBRARY_REVISION "unknown"
+#endif
+
 using namespace Penner;
 using namespace Penner::Field;
 using namespace Penner::Holonomy;
@@ -108,13 +124,11 @@ Eigen::MatrixXd optimize_aligned_parameterization(
     SymDir::Parameters param = read_parameters(config);
     param.fix_boundary = fix_boundary;
 
-    igl::Timer timer;
-    double time = 0;
-    timer.start();
+    ScopedTimer cut_timer("cut uv mesh", "uv optimization");
 	MeshCutter meshcutter(V_init, uv, F_init, F);
 	auto [V, EE] = meshcutter.cut_mesh();
     Eigen::MatrixXi FE(0, 0);
-    time = timer.getElapsedTime();
+    cut_timer.stop();
     if (param.do_feature_alignment)
     {
         // Loading the feature edge constraints
@@ -123,6 +137,7 @@ Eigen::MatrixXd optimize_aligned_parameterization(
     double cons_residual = check_constraints(EE, FE, uv, F);
     spdlog::info("Initial constraints error {}", cons_residual);
 
+    ScopedTimer setup_timer("setup uv optimization", "uv optimization");
     Eigen::MatrixXi new_F;
     Eigen::MatrixXd new_V, new_uv;
     SymDir::ExtremeOpt extremeopt(V, F);
@@ -146,11 +161,14 @@ Eigen::MatrixXd optimize_aligned_parameterization(
 
     //extremeopt.view();
     extremeopt.comb_matchings(reference_field, thetas, period_jumps);
+    setup_timer.stop();
 
     Eigen::MatrixXi F_opt = F;
     Eigen::MatrixXd uv_opt;
+    ScopedTimer optimization_timer("optimize uv", "uv optimization");
     extremeopt.do_optimization_without_log();
     extremeopt.export_mesh(V, F_opt, uv_opt);
+    optimization_timer.stop();
 
     return uv_opt;
 }
@@ -162,104 +180,27 @@ Eigen::MatrixXi tag_cone_corners(
     const Eigen::MatrixXi& F,
     const Eigen::MatrixXd& uv,
     const Eigen::MatrixXi& FT,
-    const std::vector<FaceEdge>& feature_face_edges
+    const Eigen::MatrixXi& is_feature,
+    const HalfedgeConnectivity& connectivity
 ) {
-    // get mask of feature corners
-    int num_faces = FT.rows();
-    int num_vertices = V.rows();
-    Eigen::MatrixXi is_feature = compute_mask_from_face_edges(num_faces, feature_face_edges);
-
-    // get triangle adjacency for mesh
-    Eigen::MatrixXi TT, TTi;
-	igl::triangle_triangle_adjacency(F, TT, TTi);
-
-    // get unioned vertices, split by features
-    int num_halfedges = 3 * num_faces;
-    UnionFind cut_vertices(num_halfedges);
-    //Eigen::MatrixXi is_boundary = Eigen::MatrixXi::Zero(num_faces, 3);
-    Eigen::VectorXi is_boundary = Eigen::VectorXi::Zero(num_vertices);
-    for (int f = 0; f < num_faces; ++f) {
-        for (int i = 0 ; i < 3; ++i)
-        {
-            int l = (i + 2) % 3;
-
-            // mark feature edges
-            if (is_feature(f, l))
-            {
-                //is_boundary(f, i) = 1;
-                is_boundary(F(f, i)) = 1;
-            }
-            // union tips across edge otherwise
-            else
-            {
-                // halfedge with F(f, i) at tip
-                int hki = 3 * f + i;
-
-                // get halfedge rotated clockwise, using libigls halfedge base indexing
-                int f_opp = TT(f, i);
-                int j = TTi(f, i); // index for halfedge opposite hij
-                int k = (j + 1) % 3; // index for halfedge in f pointing to vi
-                int hji = 3 * f_opp + k;
-                cut_vertices.union_sets(hki, hji);
-            }
-        }
-    }
-
-    // compute cone angles of unioned vertices
-    int num_cut_vertices = cut_vertices.count_sets();
-    std::vector<int> set_index = cut_vertices.index_sets();
-    Eigen::MatrixXd corner_angles;
-    igl::internal_angles(uv, FT, corner_angles);
-    VectorX cone_angles = VectorX::Zero(num_cut_vertices);
-    for (int fijk = 0; fijk < num_faces; ++fijk)
-    {
-        for (int i = 0; i < 3; ++i)
-        {
-            int vi = set_index[3 * fijk + i];
-            cone_angles[vi] += corner_angles(fijk, i);
-        }
-    }
-
-    Eigen::MatrixXi vertex_indices(num_faces, 3);
-    Eigen::MatrixXd halfedge_tip_angles = Eigen::MatrixXd::Zero(num_faces, 3);
-    Eigen::MatrixXi is_cone = Eigen::MatrixXi::Zero(num_faces, 3);
-    for (int f = 0; f < num_faces; ++f) {
-        for (int i = 0 ; i < 3; ++i)
-        {
-            int h = 3 * f + i;
-            int v = set_index[h];
-            vertex_indices(f, i) = v;
-            halfedge_tip_angles(f, i) += cone_angles[v];
-        }
-    }
-
-    int num_uv_vertices = uv.rows();
-    std::vector<bool> is_uv_cone(num_uv_vertices, false);
-    Eigen::VectorXi is_uv_cone_mask = Eigen::VectorXi::Zero(num_uv_vertices);
-    for (int f = 0; f < num_faces; ++f) {
-        for (int i = 0 ; i < 3; ++i)
-        {
-            int v = F(f, i);
-            int vt = FT(f, i);
-            if ((!is_boundary[v]) && (!float_equal(halfedge_tip_angles(f, i), 2 * PI)))
-            {
-                is_cone(f, i) = 1;
-                is_uv_cone[vt] = true;
-                is_uv_cone_mask[vt] = 1;
-            }
-            else if ((is_boundary[v]) && (!float_equal(halfedge_tip_angles(f, i), PI)))
-            {
-                is_cone(f, i) = 1;
-                is_uv_cone[vt] = true;
-                is_uv_cone_mask[vt] = 1;
-            }
-        }
-    }
+    // find cones of the mesh cut along features in parallel
+    ConeCorners cone_corners = compute_cone_corners(F, uv, FT, is_feature, connectivity);
+    const Eigen::MatrixXi& is_cone = cone_corners.is_cone;
 
 #ifdef ENABLE_VISUALIZATION
     bool show_uv_cones = false;
     if (show_uv_cones)
     {
+        const Eigen::MatrixXi& vertex_indices = cone_corners.vertex_indices;
+        const Eigen::MatrixXd& halfedge_tip_angles = cone_corners.corner_cone_angles;
+        const Eigen::VectorXi& is_boundary = cone_corners.is_boundary;
+        Eigen::VectorXi is_uv_cone_mask = Eigen::VectorXi::Zero(uv.rows());
+        for (int f = 0; f < FT.rows(); ++f) {
+            for (int i = 0; i < 3; ++i) {
+                if (is_cone(f, i)) is_uv_cone_mask[FT(f, i)] = 1;
+            }
+        }
+
         polyscope::init();
 
         // closed mesh
@@ -308,51 +249,135 @@ Eigen::MatrixXi tag_cone_corners(
 }
 
 
-int main(int argc, char* argv[])
+/**
+ * @brief Options shared by all meshes processed by the parameterization pipeline
+ */
+struct PipelineOptions
 {
-    spdlog::set_level(spdlog::level::info);
-
-    // Get command line arguments
-    CLI::App app{"Generate a feature aligned parametrization."};
-    std::string mesh = "";
     std::string input_dir = "./";
     std::string output_dir = "./";
-    std::filesystem::path current_dir = std::filesystem::path(__FILE__).parent_path();
-    std::filesystem::path input_json = current_dir / "symdir.json";
+    std::string cache_dir = "";
+    bool use_existing_field = false;
     bool use_uniform_bc = false;
-    bool optimize = false;
     bool use_free_cones = false;
-
+    bool optimize = false;
+    bool show_field = false;
+    bool show_parameterization = false;
+    bool resume = false;
+    bool remove_cache = false; // remove the preprocessing cache once the outputs are written
+    bool use_mesh_log_dir = false; // write optimization logs to a subdirectory per mesh
+    bool low_memory = false; // release the generator before the outputs and log stage peaks
+    bool bundle = false;
+    int compression_level = 0;
     int full_itr = 100;
+    int max_itr = 500;
     NewtonParameters alg_params;
-    int max_itr = alg_params.max_itr;
-    spdlog::level::level_enum log_level = spdlog::level::info;
+#if USE_UV_OPTIMIZATION
+    nlohmann::json uv_config;
+#endif
+};
 
-    // IO Parameters
-    bool use_existing_field = false;
-    bool show_field = false;
-    bool show_parameterization = false;
-    app.add_option("--name", mesh, "Mesh name (without obj suffix, e.g., fandisk)")->required();
-    app.add_option("-i,--input", input_dir, "Input directory")->check(CLI::ExistingDirectory)->required();
-    app.add_option("-o,--output", output_dir, "Output directory");
-    app.add_flag("--use_existing_field", use_existing_field, "Use precomputed field at the input directory");
-    app.add_flag("--use_uniform_bc", use_uniform_bc, "Use uniform barycentric coordinates");
-    app.add_flag("--use_free_cones", use_free_cones, "Use free cones and remove holonomy constraints");
-    app.add_flag("--optimize", optimize, "Optimize uv coordinates");
-    app.add_flag("--show_field", show_field, "Show field constraints");
-    app.add_flag("--show_parameterization", show_parameterization, "Show aligned parameterization");
-    app.add_option("--full_itr", full_itr, "Initial iterations of full (potentially unsatisfiable) constraints");
-    app.add_option("--log_level", log_level, "Level of logging")
-        ->transform(CLI::CheckedTransformer(log_level_map, CLI::ignore_case));
+// report the peak memory after a pipeline stage, which is logged by default in low memory mode
+void report_peak_memory(const std::string& stage, const PipelineOptions& options)
+{
+    log_peak_memory(stage, (options.low_memory) ? spdlog::level::info : spdlog::level::debug);
+}
 
-    CLI11_PARSE(app, argc, argv);
-    spdlog::set_level(log_level);
+// fixed parameters of the field generation in preprocess_mesh
+constexpr int FIELD_DIRECTION_RADIUS = 5;
+constexpr double FIELD_REL_ANISOTROPY = 0.9;
+constexpr double FIELD_ABS_ANISOTROPY = 0.2;
 
-    // Marked Metric Parameters
-    add_newton_parameters(app, alg_params);
-    CLI11_PARSE(app, argc, argv);
+MarkedMetricParameters generate_field_metric_parameters()
+{
+    MarkedMetricParameters marked_metric_params;
+    marked_metric_params.remove_trivial_torus = false; // FIXME
+    marked_metric_params.use_log_length = true;
+    marked_metric_params.use_initial_zero = false;
+    return marked_metric_params;
+}
+
+// hash the input mesh, the fixed preprocessing parameters and the library revision, so that a
+// field cache is only used by a run that would generate the same preprocessed data
+uint64_t hash_preprocessing_inputs(uint64_t mesh_hash)
+{
+    MarkedMetricParameters marked_metric_params = generate_field_metric_parameters();
+    std::string parameters = fmt::format(
+        "library={};radius={};rel_anisotropy={};abs_anisotropy={};remove_trivial_torus={};"
+        "use_log_length={};use_initial_zero={}",
+        PENNER_LIBRARY_REVISION,
+        FIELD_DIRECTION_RADIUS,
+        FIELD_REL_ANISOTROPY,
+        FIELD_ABS_ANISOTROPY,
+        marked_metric_params.remove_trivial_torus,
+        marked_metric_params.use_log_length,
+        marked_metric_params.use_initial_zero);
+    return hash_bytes(parameters.data(), parameters.size(), mesh_hash);
+}
+
+// hash the preprocessing inputs and the options that determine the refined parameterization, so
+// that a checkpoint is only resumed by a run that would generate the same parameterization
+uint64_t hash_parameterization_inputs(
+    const std::string& mesh,
+    uint64_t preprocessing_key,
+    const PipelineOptions& options)
+{
+    const NewtonParameters& alg_params = options.alg_params;
+    std::string parameters = fmt::format(
+        "use_existing_field={};use_uniform_bc={};use_free_cones={};full_itr={};max_itr={};"
+        "solver={};reset_lambda={};bound_norm_thres={}",
+        options.use_existing_field,
+        options.use_uniform_bc,
+        options.use_free_cones,
+        options.full_itr,
+        options.max_itr,
+        alg_params.solver,
+        alg_params.reset_lambda,
+        alg_params.bound_norm_thres);
+    uint64_t key = hash_bytes(parameters.data(), parameters.size(), preprocessing_key);
+
+    // precomputed features and field are also inputs
+    if (options.use_existing_field)
+    {
+        for (std::string suffix : {"_features", "_hard_features", ".ffield"})
+        {
+            uint64_t file_hash = hash_file(join_path(options.input_dir, mesh + suffix));
+            key = hash_bytes(reinterpret_cast<const char*>(&file_hash), sizeof(file_hash), key);
+        }
+    }
 
-    std::filesystem::create_directory(output_dir);
+    return key;
+}
+
+// hash the parameterization inputs and the options that determine the final outputs, so that
+// resumed runs only skip meshes that were completed with the same inputs and options
+uint64_t hash_output_inputs(uint64_t parameterization_key, const PipelineOptions& options)
+{
+    std::string parameters = fmt::format("optimize={}", options.optimize);
+#if USE_UV_OPTIMIZATION
+    if (options.optimize) parameters += ";uv_config=" + options.uv_config.dump();
+#endif
+    return hash_bytes(parameters.data(), parameters.size(), parameterization_key);
+}
+
+// check that a library writer without a status created a nonempty output file
+void require_output(const std::string& filename)
+{
+    std::error_code error_code;
+    if ((!std::filesystem::exists(filename, error_code)) ||
+        (std::filesystem::file_size(filename, error_code) == 0) || (error_code))
+    {
+        throw std::runtime_error("could not write " + filename);
+    }
+}
+
+// load the input mesh, features, and field, refining and generating them if necessary
+FeatureFieldData preprocess_mesh(
+    const std::string& mesh,
+    uint64_t preprocessing_key,
+    const PipelineOptions& options)
+{
+    const std::string& input_dir = options.input_dir;
 
     // create filepaths for input data
     std::string mesh_filename = join_path(input_dir, mesh + ".obj");
@@ -364,7 +389,6 @@ int main(int argc, char* argv[])
     Eigen::MatrixXd V, uv, N;
     Eigen::MatrixXi F, FT, FN;
     spdlog::info("optimizing mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, uv, N, F, FT, FN);
 
     // Get features and field
     std::vector<VertexEdge> feature_edges, hard_feature_edges;
@@ -372,8 +396,27 @@ int main(int argc, char* argv[])
     Eigen::VectorXd theta;
     Eigen::MatrixXd kappa;
     Eigen::MatrixXi period_jump;
-    if (use_existing_field)
+
+    // check for cached preprocessing of the same input mesh
+    bool use_cache = ((!options.use_existing_field) && (!options.cache_dir.empty()));
+    std::string cache_filename = join_path(options.cache_dir, mesh + ".pfc");
+    uint64_t cache_key = preprocessing_key;
+    FeatureFieldData cache_data;
+    ScopedTimer cache_timer("load cache", "io");
+    bool is_cached = ((use_cache) && (load_field_cache(cache_filename, cache_key, cache_data)));
+    cache_timer.stop();
+    if (is_cached)
+    {
+        spdlog::info("loading preprocessed mesh and field from {}", cache_filename);
+        return cache_data;
+    }
+    else if (options.use_existing_field)
     {
+        ScopedTimer load_timer("load mesh and field", "io");
+        if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) {
+            throw std::runtime_error("could not read mesh at " + mesh_filename);
+        }
+
         spdlog::info("loading feature edges");
         feature_edges = load_feature_edges(feature_filename);
         hard_feature_edges = load_feature_edges(hard_feature_filename);
@@ -382,37 +425,83 @@ int main(int argc, char* argv[])
         std::tie(reference_field, theta, kappa, period_jump) = Penner::Field::load_frame_field(field_filename);
     }
     else {
+        ScopedTimer load_timer("load mesh", "io");
+        if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) {
+            throw std::runtime_error("could not read mesh at " + mesh_filename);
+        }
+        load_timer.stop();
+
         // refine input mesh
+        ScopedTimer refine_timer("refine mesh");
         std::tie(V, F, feature_edges, hard_feature_edges) = generate_refined_feature_mesh(V, F, false);
+        refine_timer.stop();
+        report_peak_memory("refine mesh", options);
+        ScopedTimer cut_timer("cut features");
         FeatureFinder feature_finder(V, F);
         feature_finder.mark_features(feature_edges);
         auto[V_cut, F_cut, V_map, F_is_feature] = feature_finder.generate_feature_cut_mesh();
+        cut_timer.stop();
 
-        int radius = 5;
-        Scalar rel_anisotropy=0.9;
-        Scalar abs_anisotropy=0.2;
+        int radius = FIELD_DIRECTION_RADIUS;
+        Scalar rel_anisotropy = FIELD_REL_ANISOTROPY;
+        Scalar abs_anisotropy = FIELD_ABS_ANISOTROPY;
         Scalar bb_diag = igl::bounding_box_diagonal(V);
+        ScopedTimer direction_timer("fit field directions");
         auto [direction, is_fixed_direction] = Penner::Field::compute_field_direction(
             V_cut,
             F_cut,
             radius,
             abs_anisotropy / bb_diag,
             rel_anisotropy);
-        MarkedMetricParameters marked_metric_params;
-        marked_metric_params.remove_trivial_torus = false; // FIXME
-        marked_metric_params.use_log_length = true;
-        marked_metric_params.use_initial_zero = false;
+        direction_timer.stop();
+        ScopedTimer field_timer("generate field");
+        MarkedMetricParameters marked_metric_params = generate_field_metric_parameters();
         CutMetricGenerator cut_metric_generator(V_cut, F_cut, marked_metric_params, {});
         cut_metric_generator.generate_fields(V_cut, F_cut, V_map, direction, is_fixed_direction);
         std::tie(reference_field, theta, kappa, period_jump) = cut_metric_generator.get_field();
+        field_timer.stop();
+        report_peak_memory("generate field", options);
     }
-    if (show_field) view_cross_field(V, F, reference_field, theta, kappa, period_jump);
+
+    FeatureFieldData data = {
+        std::move(V),
+        std::move(F),
+        std::move(feature_edges),
+        std::move(hard_feature_edges),
+        std::move(reference_field),
+        std::move(theta),
+        std::move(kappa),
+        std::move(period_jump)};
+
+    // cache preprocessing for reruns with different optimization parameters
+    if (use_cache)
+    {
+        ScopedTimer write_cache_timer("write cache", "io");
+        spdlog::info("caching preprocessed mesh and field at {}", cache_filename);
+        std::filesystem::create_directories(options.cache_dir);
+        if (!write_field_cache(cache_filename, cache_key, data))
+        {
+            spdlog::warn("could not write cache {}", cache_filename);
+        }
+    }
+
+    return data;
+}
+
+// optimize the aligned metric and generate the refined parameterization, consuming the input data
+RefinedParameterization generate_parameterization(
+    const std::string& mesh,
+    FeatureFieldData data,
+    const PipelineOptions& options)
+{
+    bool use_free_cones = options.use_free_cones;
+    NewtonParameters alg_params = options.alg_params;
 
     // get optimized metric
     spdlog::info("projecting to feature constraints");
-    alg_params.output_dir = output_dir;
+    alg_params.output_dir = (options.use_mesh_log_dir) ? join_path(options.output_dir, mesh) : options.output_dir;
+    std::filesystem::create_directories(alg_params.output_dir);
     alg_params.error_eps = 1e-10;
-    alg_params.solver = "ldlt";
     alg_params.do_reduction = true;
     MarkedMetricParameters marked_metric_params;
     if (use_free_cones)
@@ -422,52 +511,141 @@ int main(int argc, char* argv[])
         marked_metric_params.max_boundary_constraints = 0;
         marked_metric_params.max_loop_constraints = 0;
     }
-    AlignedMetricGenerator aligned_metric_generator(
-        V,
-        F,
-        feature_edges,
-        hard_feature_edges,
-        reference_field,
-        theta,
-        kappa,
-        period_jump,
+    ScopedTimer build_timer("build aligned metric", "newton");
+    auto aligned_metric_generator = std::make_unique<AlignedMetricGenerator>(
+        data.V,
+        data.F,
+        data.feature_edges,
+        data.hard_feature_edges,
+        data.reference_field,
+        data.theta,
+        data.kappa,
+        data.period_jump,
         marked_metric_params);
+    build_timer.stop();
+    report_peak_memory("build aligned metric", options);
 
     // run iterations of fully optimized method
-    alg_params.max_itr = full_itr;
-    aligned_metric_generator.optimize_full(alg_params);
+    alg_params.max_itr = options.full_itr;
+    {
+        ScopedTimer timer("optimize full", "newton");
+        aligned_metric_generator->optimize_full(alg_params);
+    }
 
     // only works for feature alignment
     if (!use_free_cones)
     {
         // run iterations of relaxed optimization
-        alg_params.max_itr = max_itr;
-        aligned_metric_generator.optimize_relaxed(alg_params);
+        alg_params.max_itr = options.max_itr;
+        ScopedTimer timer("optimize relaxed", "newton");
+        aligned_metric_generator->optimize_relaxed(alg_params);
     }
     else
     {
-        aligned_metric_generator.is_axis_aligned = false;
+        aligned_metric_generator->is_axis_aligned = false;
     }
-
-    aligned_metric_generator.parameterize(false, use_uniform_bc);
-    auto [V_r, F_r, uv_r, FT_r, fn_to_f_r, endpoints_r] = aligned_metric_generator.get_parameterization();
-    auto [feature_face_edges, misaligned_edges] = aligned_metric_generator.get_refined_features();
-    auto feature_edges_r = compute_face_edge_endpoints(feature_face_edges, F_r);
-    auto misaligned_edges_r = compute_face_edge_endpoints(misaligned_edges, F_r);
-    auto [reference_field_r, theta_r, kappa_r, period_jump_r] = aligned_metric_generator.get_refined_field();
+    report_peak_memory("optimize metric", options);
+
+    ScopedTimer parameterize_timer("parameterize");
+    aligned_metric_generator->parameterize(false, options.use_uniform_bc);
+    parameterize_timer.stop();
+    report_peak_memory("parameterize", options);
+
+    // the accessors return copies, so the generator state and the results coexist at this point,
+    // which is the peak of the pipeline in either memory mode; the copies are then moved into the
+    // parameterization to avoid a second copy
+    RefinedParameterization parameterization;
+    auto [V_r, F_r, uv_r, FT_r, fn_to_f_r, endpoints_r] = aligned_metric_generator->get_parameterization();
+    auto [feature_face_edges, misaligned_edges] = aligned_metric_generator->get_refined_features();
+    auto [reference_field_r, theta_r, kappa_r, period_jump_r] = aligned_metric_generator->get_refined_field();
+    parameterization.V = std::move(V_r);
+    parameterization.F = std::move(F_r);
+    parameterization.uv = std::move(uv_r);
+    parameterization.FT = std::move(FT_r);
+    parameterization.fn_to_f = Eigen::Map<const Eigen::VectorXi>(fn_to_f_r.data(), fn_to_f_r.size());
+    parameterization.reference_field = std::move(reference_field_r);
+    parameterization.theta = std::move(theta_r);
+    parameterization.kappa = std::move(kappa_r);
+    parameterization.period_jump = std::move(period_jump_r);
+
+    // release the metric and optimizer state before building derived data and the outputs
+    if (options.low_memory) aligned_metric_generator.reset();
+
+    const Eigen::MatrixXi& F = parameterization.F;
+    parameterization.is_feature = compute_mask_from_face_edges(F.rows(), feature_face_edges);
+    parameterization.feature_edges = compute_face_edge_endpoints(feature_face_edges, F);
+    parameterization.misaligned_edges = compute_face_edge_endpoints(misaligned_edges, F);
 
     // for free cones, mark all feature edges
     if (use_free_cones)
     {
-        feature_edges_r = feature_edges;
+        parameterization.feature_edges = std::move(data.feature_edges);
+    }
+    report_peak_memory("extract parameterization", options);
+
+    return parameterization;
+}
+
+void parameterize_mesh(const std::string& mesh, const PipelineOptions& options)
+{
+    // attribute trace events of this mesh, which may run concurrently with others in a batch
+    ScopedTraceContext trace_context(mesh);
+    ScopedTimer mesh_timer("parameterize mesh");
+    const std::string& output_dir = options.output_dir;
+    std::string mesh_filename = join_path(options.input_dir, mesh + ".obj");
+    std::string checkpoint_filename = join_path(output_dir, mesh + "_checkpoint.pfc");
+
+    // key the checkpoint and outputs on the inputs and options that produce them
+    uint64_t preprocessing_key = hash_preprocessing_inputs(hash_file(mesh_filename));
+    uint64_t checkpoint_key = hash_parameterization_inputs(mesh, preprocessing_key, options);
+    uint64_t output_key = hash_output_inputs(checkpoint_key, options);
+
+    // skip meshes that were completed by a previous run with the same key
+    std::string bundle_filename = join_path(output_dir, mesh+"_opt.bin");
+    std::string marker_filename = join_path(output_dir, mesh+"_opt.done");
+    bool is_completed = (options.bundle) ? is_output_bundle_complete(bundle_filename, output_key)
+                                         : is_completion_marked(marker_filename, output_key);
+    if ((options.resume) && (is_completed))
+    {
+        spdlog::info("skipping completed mesh {}", mesh);
+        return;
+    }
+
+    // resume from the refined parameterization if it was checkpointed, and generate it otherwise
+    RefinedParameterization parameterization;
+    ScopedTimer checkpoint_timer("load checkpoint", "io");
+    bool is_checkpointed = ((options.resume) && (load_parameterization_checkpoint(checkpoint_filename, checkpoint_key, parameterization)));
+    checkpoint_timer.stop();
+    if (is_checkpointed)
+    {
+        spdlog::info("resuming from checkpoint {}", checkpoint_filename);
     }
+    else
+    {
+        FeatureFieldData data = preprocess_mesh(mesh, preprocessing_key, options);
+        if (options.show_field) view_cross_field(data.V, data.F, data.reference_field, data.theta, data.kappa, data.period_jump);
+        parameterization = generate_parameterization(mesh, std::move(data), options);
+
+        // checkpoint before the potentially long uv optimization
+        if (options.optimize)
+        {
+            ScopedTimer timer("write checkpoint", "io");
+            spdlog::info("writing checkpoint to {}", checkpoint_filename);
+            write_parameterization_checkpoint(checkpoint_filename, checkpoint_key, parameterization);
+        }
+    }
+    const Eigen::MatrixXd& V_r = parameterization.V;
+    const Eigen::MatrixXi& F_r = parameterization.F;
+    Eigen::MatrixXd& uv_r = parameterization.uv;
+    const Eigen::MatrixXi& FT_r = parameterization.FT;
+    const auto& feature_edges_r = parameterization.feature_edges;
+    const auto& misaligned_edges_r = parameterization.misaligned_edges;
 
     // Optionally optimize parameterization 
-    if (optimize)
+    if (options.optimize)
     {
 #if USE_UV_OPTIMIZATION
-        std::ifstream js_in(input_json);
-        nlohmann::json config = nlohmann::json::parse(js_in);
+        nlohmann::json config = options.uv_config;
         config["model"] = mesh;
 
         // get feature edges
@@ -488,44 +666,228 @@ int main(int argc, char* argv[])
             ME(eij, 1) = misaligned_edges_r[eij][1];
         }
 
-        bool fix_boundary = use_free_cones; // fix boundary if using free cones
+        bool fix_boundary = options.use_free_cones; // fix boundary if using free cones
         uv_r = optimize_aligned_parameterization(
             V_r,
             F_r,
             uv_r,
             FT_r,
-            reference_field_r,
-            theta_r,
-            period_jump_r,
+            parameterization.reference_field,
+            parameterization.theta,
+            parameterization.period_jump,
             FE,
             ME,
             config,
             fix_boundary);
+        report_peak_memory("optimize uv", options);
 #else
         spdlog::warn("uv optimization disabled");
 #endif
     }
 
-    if (show_parameterization) view_seamless_parameterization(V_r, F_r, uv_r, FT_r, "refined mesh", true);
+    if (options.show_parameterization) view_seamless_parameterization(V_r, F_r, uv_r, FT_r, "refined mesh", true);
 
-    std::string output_filename = join_path(output_dir, mesh+"_opt.obj");
-    write_obj_with_uv(output_filename, V_r, F_r, uv_r, FT_r);
-    write_mesh_edges(output_filename, feature_edges_r);
-    output_filename = join_path(output_dir, mesh+".ffield");
-    Penner::Field::write_frame_field(output_filename,  reference_field_r, theta_r, kappa_r, period_jump_r);
-    output_filename = join_path(output_dir, mesh+"_fn_to_f");
-    write_vector(fn_to_f_r, output_filename);
+    // build connectivity of the refined mesh for cone tagging
+    HalfedgeConnectivity connectivity = build_halfedge_connectivity(F_r, V_r.rows());
+    spdlog::debug("Built connectivity for {} halfedges", connectivity.num_halfedges());
 
     // get uv cone vertices
-    Eigen::MatrixXi is_cone_corner = tag_cone_corners(V_r, F_r, uv_r, FT_r, feature_face_edges);
+    ScopedTimer cone_timer("tag cone corners");
+    Eigen::MatrixXi is_cone_corner =
+        tag_cone_corners(V_r, F_r, uv_r, FT_r, parameterization.is_feature, connectivity);
+    cone_timer.stop();
     //std::vector<int> uv_cone_vertices;
     //convert_boolean_array_to_index_vector(is_cone_uv, uv_cone_vertices);
-    output_filename = join_path(output_dir, mesh+"_uv_cone_corners");
-    write_integer_matrix(is_cone_corner, output_filename, " ");
+
+    ScopedTimer output_timer("write output", "io");
+    if (options.bundle)
+    {
+        spdlog::info("writing output bundle to {}", bundle_filename);
+        if (!write_output_bundle(bundle_filename, output_key, parameterization, is_cone_corner, options.compression_level)) {
+            throw std::runtime_error("could not write output bundle " + bundle_filename);
+        }
+    }
+    else
+    {
+        std::string output_filename = join_path(output_dir, mesh+"_opt.obj");
+        if (!write_obj_mesh(output_filename, V_r, F_r, uv_r, FT_r)) {
+            throw std::runtime_error("could not write mesh " + output_filename);
+        }
+        write_mesh_edges(output_filename, feature_edges_r);
+        if (load_mesh_edges(output_filename).size() != feature_edges_r.size()) {
+            throw std::runtime_error("could not write feature edges for " + output_filename);
+        }
+        output_filename = join_path(output_dir, mesh+".ffield");
+        Penner::Field::write_frame_field(
+            output_filename,
+            parameterization.reference_field,
+            parameterization.theta,
+            parameterization.kappa,
+            parameterization.period_jump);
+        require_output(output_filename);
+        output_filename = join_path(output_dir, mesh+"_fn_to_f");
+        write_vector(parameterization.fn_to_f, output_filename);
+        require_output(output_filename);
+        output_filename = join_path(output_dir, mesh+"_uv_cone_corners");
+        write_integer_matrix(is_cone_corner, output_filename, " ");
+        require_output(output_filename);
+
+        // mark the mesh as complete only after all outputs are written
+        if (!write_completion_marker(marker_filename, output_key)) {
+            throw std::runtime_error("could not write completion marker " + marker_filename);
+        }
+    }
+    output_timer.stop();
+    report_peak_memory("write output", options);
+
+    // the checkpoint and default resume cache are no longer needed once all outputs are written
+    std::filesystem::remove(checkpoint_filename);
+    if (options.remove_cache) std::filesystem::remove(join_path(options.cache_dir, mesh + ".pfc"));
 
     //std::string output_filename = join_path(output_dir, "optimized_corner_coords");
     //write_matrix(opt_corner_coords, output_filename, " ");
+}
+
+int main(int argc, char* argv[])
+{
+    spdlog::set_level(spdlog::level::info);
+
+    // Get command line arguments
+    CLI::App app{"Generate a feature aligned parametrization."};
+    std::string mesh = "";
+    std::filesystem::path current_dir = std::filesystem::path(__FILE__).parent_path();
+    std::string input_json = (current_dir / "symdir.json").string();
+    PipelineOptions options;
+    options.alg_params.solver = "ldlt";
+    spdlog::level::level_enum log_level = spdlog::level::info;
+    std::string trace_filename = "";
+
+    // Batch Parameters
+    std::string manifest = "";
+    bool batch = false;
+    int num_workers = 1;
+    std::string summary_filename = "";
+
+    // IO Parameters
+    auto name_option = app.add_option("--name", mesh, "Mesh name (without obj suffix, e.g., fandisk)");
+    app.add_option("-i,--input", options.input_dir, "Input directory")->check(CLI::ExistingDirectory)->required();
+    app.add_option("-o,--output", options.output_dir, "Output directory");
+    app.add_flag("--use_existing_field", options.use_existing_field, "Use precomputed field at the input directory");
+    app.add_option("--cache_dir", options.cache_dir, "Directory to cache the preprocessed mesh and field for reruns");
+    app.add_flag("--resume", options.resume, "Resume from checkpoints and skip completed meshes in the output directory");
+    app.add_flag("--low_memory", options.low_memory, "Release the metric optimizer before writing outputs and report peak memory per stage");
+    app.add_flag("--bundle", options.bundle, "Write all outputs to a single binary bundle <name>_opt.bin");
+    app.add_option("--compression_level", options.compression_level, "Zstd compression level for the output bundle (0 for none)")
+        ->check(CLI::Range(0, 22));
+    app.add_flag("--use_uniform_bc", options.use_uniform_bc, "Use uniform barycentric coordinates");
+    app.add_flag("--use_free_cones", options.use_free_cones, "Use free cones and remove holonomy constraints");
+    app.add_flag("--optimize", options.optimize, "Optimize uv coordinates");
+    app.add_option("--uv_config", input_json, "Json parameters for uv optimization")
+        ->check(CLI::ExistingFile)
+        ->capture_default_str();
+    app.add_flag("--show_field", options.show_field, "Show field constraints");
+    app.add_flag("--show_parameterization", options.show_parameterization, "Show aligned parameterization");
+    app.add_option("--full_itr", options.full_itr, "Initial iterations of full (potentially unsatisfiable) constraints");
+    app.add_option("--log_level", log_level, "Level of logging")
+        ->transform(CLI::CheckedTransformer(log_level_map, CLI::ignore_case));
+    app.add_option("--trace", trace_filename, "Output json file for a Chrome trace of the pipeline stages");
+
+    // Batch options
+    auto manifest_option = app.add_option("--manifest", manifest, "File of mesh names to process in batch, one per line")
+        ->check(CLI::ExistingFile)
+        ->excludes(name_option);
+    app.add_flag("--batch", batch, "Process all obj meshes in the input directory")
+        ->excludes(name_option)
+        ->excludes(manifest_option);
+    app.add_option("--num_workers", num_workers, "Number of meshes to process concurrently in batch mode")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--summary", summary_filename, "Output csv file for batch timings and status (default: <output>/summary.csv)");
+
+    // Newton Parameters
+    add_newton_parameters(app, options.alg_params);
+
+    CLI11_PARSE(app, argc, argv);
+    spdlog::set_level(log_level);
+    options.max_itr = options.alg_params.max_itr;
+    spdlog::info("Using {} solver for Newton steps", options.alg_params.solver);
+
+    std::filesystem::create_directory(options.output_dir);
+    if (!trace_filename.empty()) Profiler::instance().enable();
 
+    // resuming reuses cached preprocessing, which is stored with the output by default and
+    // removed once the mesh is complete
+    if ((options.resume) && (options.cache_dir.empty()))
+    {
+        options.cache_dir = options.output_dir;
+        options.remove_cache = true;
+    }
 
+    // load the uv optimization config once for all meshes
+#if USE_UV_OPTIMIZATION
+    if (options.optimize)
+    {
+        spdlog::info("loading uv optimization parameters from {}", input_json);
+        std::ifstream js_in(input_json);
+        options.uv_config = nlohmann::json::parse(js_in);
+    }
+#endif
 
+    // process single mesh
+    if ((manifest.empty()) && (!batch))
+    {
+        if (mesh.empty())
+        {
+            spdlog::error("One of --name, --manifest, or --batch is required");
+            return 1;
+        }
+        bool is_parameterized = true;
+        try
+        {
+            parameterize_mesh(mesh, options);
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::error("Failed to parameterize {}: {}", mesh, e.what());
+            is_parameterized = false;
+        }
+        if (!trace_filename.empty()) Profiler::instance().write_trace(trace_filename);
+        return (is_parameterized) ? 0 : 1;
+    }
+
+    // get meshes to process in batch
+    std::vector<std::string> meshes = (batch) ? find_batch_meshes(options.input_dir)
+                                              : load_batch_manifest(manifest);
+    spdlog::info("Processing {} meshes with {} workers", meshes.size(), num_workers);
+
+    // viewers cannot be opened from worker threads, and concurrent meshes need separate logs
+    options.show_field = false;
+    options.show_parameterization = false;
+    options.use_mesh_log_dir = true;
+
+    // split available cores between workers to avoid oversubscription
+    int thread_budget = compute_thread_budget(num_workers);
+#ifdef _OPENMP
+    spdlog::info("Limiting Eigen, OpenMP and application loops to {} threads per worker", thread_budget);
+#else
+    spdlog::info("Limiting Eigen and application loops to {} threads per worker", thread_budget);
+    spdlog::warn("Built without OpenMP, so library OpenMP regions are not limited per worker");
+#endif
+    Eigen::setNbThreads(thread_budget);
+    auto process_mesh = [&](const std::string& name) {
+        set_num_threads(thread_budget);
+#ifdef _OPENMP
+        omp_set_num_threads(thread_budget);
+#endif
+        parameterize_mesh(name, options);
+    };
+
+    if (summary_filename.empty()) summary_filename = join_path(options.output_dir, "summary.csv");
+    std::vector<BatchResult> results = run_batch(meshes, process_mesh, num_workers, summary_filename);
+    int num_failed = std::count_if(results.begin(), results.end(), [](const BatchResult& result) {
+        return !result.success;
+    });
+    spdlog::info("Processed {} meshes with {} failures", results.size(), num_failed);
+    if (!trace_filename.empty()) Profiler::instance().write_trace(trace_filename);
+
+    return (num_failed == 0) ? 0 : 1;
 }
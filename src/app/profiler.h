@@ -0,0 +1,298 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace Penner {
+
+// escape a string for a json string literal, dropping control characters
+inline std::string escape_json(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if ((c == '"') || (c == '\\')) escaped.push_back('\\');
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+// per thread context of recorded events, such as the mesh processed by a batch worker
+inline std::string& trace_context()
+{
+    thread_local std::string context;
+    return context;
+}
+
+/**
+ * @brief Set the context of events recorded by the current thread for its lifetime.
+ */
+class ScopedTraceContext
+{
+public:
+    ScopedTraceContext(const std::string& context)
+        : m_previous_context(trace_context())
+    {
+        trace_context() = context;
+    }
+
+    ~ScopedTraceContext() { trace_context() = m_previous_context; }
+    ScopedTraceContext(const ScopedTraceContext&) = delete;
+    ScopedTraceContext& operator=(const ScopedTraceContext&) = delete;
+
+private:
+    std::string m_previous_context;
+};
+
+/**
+ * @brief Global collector of timing and counter events for the pipeline stages.
+ *
+ * Events are only recorded when the profiler is enabled, and are written in the Chrome trace
+ * event format, which can be viewed with chrome://tracing or https://ui.perfetto.dev. Events
+ * carry the trace context of the recording thread, which is written as the "mesh" argument of
+ * durations and as the series name of counters. When disabled, timers only perform a single
+ * relaxed atomic load.
+ */
+class Profiler
+{
+public:
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void enable(bool enabled = true) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // get time in microseconds since the profiler was created
+    double get_time() const
+    {
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - m_start;
+        return elapsed.count();
+    }
+
+    /**
+     * @brief Record a completed duration event.
+     *
+     * @param name: name of the event
+     * @param category: category of the event
+     * @param start: start time in microseconds
+     * @param duration: duration in microseconds
+     */
+    void add_duration(const std::string& name, const std::string& category, double start, double duration)
+    {
+        if (!is_enabled()) return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push_back(
+            {name, category, trace_context(), 'X', start, duration, get_thread_index(), 0.});
+    }
+
+    /**
+     * @brief Record the value of a counter at the current time.
+     *
+     * @param name: name of the counter
+     * @param value: value of the counter
+     */
+    void add_counter(const std::string& name, double value)
+    {
+        if (!is_enabled()) return;
+        double time = get_time();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push_back(
+            {name, "counter", trace_context(), 'C', time, 0., get_thread_index(), value});
+    }
+
+    /**
+     * @brief Write all recorded events as a Chrome trace json file.
+     *
+     * @param filename: path for the trace file
+     * @return true iff the trace was written
+     */
+    bool write_trace(const std::string& filename) const
+    {
+        std::ofstream output_file(filename);
+        if (!output_file) {
+            spdlog::error("Could not open {} for writing", filename);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        output_file << std::fixed << std::setprecision(3);
+        output_file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (size_t i = 0; i < m_events.size(); ++i) {
+            const Event& event = m_events[i];
+            if (i > 0) output_file << ",";
+            output_file << "\n{\"name\":\"" << escape_json(event.name) << "\",\"cat\":\""
+                        << escape_json(event.category) << "\",\"ph\":\"" << event.phase
+                        << "\",\"ts\":" << event.start << ",\"pid\":0,\"tid\":" << event.thread;
+            std::string context = escape_json(event.context);
+            if (event.phase == 'X') {
+                output_file << ",\"dur\":" << event.duration;
+                if (!context.empty()) output_file << ",\"args\":{\"mesh\":\"" << context << "\"}";
+            } else {
+                std::string series = (context.empty()) ? "value" : context;
+                output_file << ",\"args\":{\"" << series << "\":" << event.value << "}";
+            }
+            output_file << "}";
+        }
+        output_file << "\n]}\n";
+
+        return static_cast<bool>(output_file);
+    }
+
+private:
+    struct Event
+    {
+        std::string name;
+        std::string category;
+        std::string context;
+        char phase;
+        double start;
+        double duration;
+        int thread;
+        double value;
+    };
+
+    Profiler()
+        : m_start(std::chrono::steady_clock::now())
+    {}
+
+    // get a small index for the current thread (assumes the mutex is held)
+    int get_thread_index()
+    {
+        auto itr = m_thread_indices.find(std::this_thread::get_id());
+        if (itr != m_thread_indices.end()) return itr->second;
+        int index = m_thread_indices.size();
+        m_thread_indices[std::this_thread::get_id()] = index;
+        return index;
+    }
+
+    std::atomic<bool> m_enabled = false;
+    std::chrono::steady_clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::vector<Event> m_events;
+    std::map<std::thread::id, int> m_thread_indices;
+};
+
+/**
+ * @brief Timer that records a duration event for its lifetime when profiling is enabled.
+ */
+class ScopedTimer
+{
+public:
+    // names are not copied, so they should be string literals
+    ScopedTimer(const char* name, const char* category = "pipeline")
+        : m_name(name)
+        , m_category(category)
+    {
+        Profiler& profiler = Profiler::instance();
+        if (!profiler.is_enabled()) return;
+        m_is_active = true;
+        m_start = profiler.get_time();
+    }
+
+    ~ScopedTimer() { stop(); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    // record the event before the end of the scope
+    void stop()
+    {
+        if (!m_is_active) return;
+        m_is_active = false;
+        Profiler& profiler = Profiler::instance();
+        profiler.add_duration(m_name, m_category, m_start, profiler.get_time() - m_start);
+    }
+
+private:
+    const char* m_name;
+    const char* m_category;
+    bool m_is_active = false;
+    double m_start = 0.;
+};
+
+/**
+ * @brief Get the peak resident memory of the process.
+ *
+ * On Linux, this is VmHWM, which can be reset with reset_peak_memory. Elsewhere, it is the
+ * getrusage maximum, which only increases. The peak is shared by all threads, so in batch mode
+ * it covers all concurrent meshes.
+ *
+ * @return peak resident memory in MB, or 0 if unavailable on the platform
+ */
+inline double get_peak_memory()
+{
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::stod(line.substr(6)) / 1024.; // kilobytes
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1048576.; // bytes
+#else
+    return usage.ru_maxrss / 1024.; // kilobytes
+#endif
+#else
+    return 0.;
+#endif
+}
+
+/**
+ * @brief Reset the peak resident memory to the current resident memory.
+ *
+ * @return true iff the peak was reset, which is only supported on Linux
+ */
+inline bool reset_peak_memory()
+{
+#ifdef __linux__
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5" << std::flush;
+    return static_cast<bool>(clear_refs);
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Log the peak resident memory of a stage and record it as a trace counter.
+ *
+ * The peak is reset after each report where supported, so that it covers the stage since the
+ * previous report. Otherwise, it is the running peak of the process up to the stage.
+ *
+ * @param stage: name of the completed stage
+ * @param level: logging level for the report
+ */
+inline void log_peak_memory(
+    const std::string& stage,
+    spdlog::level::level_enum level = spdlog::level::debug)
+{
+    double peak_memory = get_peak_memory();
+    if (reset_peak_memory()) {
+        spdlog::log(level, "peak memory during {}: {:.1f} MB", stage, peak_memory);
+    } else {
+        spdlog::log(level, "running peak memory after {}: {:.1f} MB", stage, peak_memory);
+    }
+    Profiler::instance().add_counter("peak memory (MB)", peak_memory);
+}
+
+} // namespace Penner
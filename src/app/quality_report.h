@@ -0,0 +1,370 @@
+#pragma once
+
+#include "cone_corners.h"
+#include "halfedge_connectivity.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace Penner {
+
+/**
+ * @brief Running maximum and mean of a nonnegative quantity
+ */
+struct Statistic
+{
+    double max = 0.;
+    double sum = 0.;
+    int64_t count = 0;
+
+    void add(double value)
+    {
+        max = std::max(max, value);
+        sum += value;
+        ++count;
+    }
+
+    void merge(const Statistic& other)
+    {
+        max = std::max(max, other.max);
+        sum += other.sum;
+        count += other.count;
+    }
+
+    double mean() const { return (count > 0) ? sum / count : 0.; }
+};
+
+/**
+ * @brief Quality measures of a seamless parameterization with features
+ */
+struct QualityReport
+{
+    int num_vertices = 0;
+    int num_faces = 0;
+    int num_flipped_faces = 0; // faces with nonpositive signed uv area
+    int num_degenerate_faces = 0; // faces with a zero length 3D or uv edge
+
+    int num_missing_feature_edges = 0; // feature edges that are not mesh edges
+    Statistic feature_alignment; // per feature edge minimum absolute uv coordinate difference
+    Statistic seam_transition; // per seam edge relative error of the best rotational transition
+    Statistic angle_distortion; // per corner absolute difference of the 3D and uv angles
+
+    int num_cones = 0;
+    int num_positive_cones = 0; // cones with angle below the flat angle
+    int num_negative_cones = 0; // cones with angle above the flat angle
+};
+
+// compute the corner angles of a triangle with the law of cosines, as in igl::internal_angles,
+// returning false without computing the angles if the triangle has a zero length edge
+template <typename Derived>
+bool compute_triangle_angles(
+    const Eigen::MatrixBase<Derived>& X,
+    int v0,
+    int v1,
+    int v2,
+    double angles[3])
+{
+    int vertices[3] = {v0, v1, v2};
+    double l_sq[3];
+    for (int i = 0; i < 3; ++i) {
+        l_sq[i] = (X.row(vertices[(i + 1) % 3]) - X.row(vertices[(i + 2) % 3])).squaredNorm();
+        if ((!(l_sq[i] > 0.)) || (!std::isfinite(l_sq[i]))) return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        double s1 = l_sq[i];
+        double s2 = l_sq[(i + 1) % 3];
+        double s3 = l_sq[(i + 2) % 3];
+        double cos_angle = (s3 + s2 - s1) / (2. * std::sqrt(s3 * s2));
+        angles[i] = std::acos(std::clamp(cos_angle, -1., 1.));
+    }
+    return true;
+}
+
+/**
+ * @brief Check that a parameterized mesh has consistent dimensions and indices.
+ *
+ * @param V: mesh vertices
+ * @param F: mesh faces
+ * @param uv: layout vertices
+ * @param FT: layout faces
+ * @param feature_edges: feature edges as vertex index pairs
+ * @return true iff the mesh and layout can be used for a quality report
+ */
+template <typename EdgeList>
+bool validate_parameterization(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const EdgeList& feature_edges)
+{
+    if ((V.cols() != 3) || (F.cols() != 3) || (FT.cols() != 3) || (uv.cols() < 2)) {
+        spdlog::error("Expected 3D vertices, 2D layout vertices and triangle faces");
+        return false;
+    }
+    if ((uv.rows() == 0) || (FT.rows() != F.rows())) {
+        spdlog::error("Expected a layout with {} faces, found {}", F.rows(), FT.rows());
+        return false;
+    }
+    if ((F.size() > 0) && ((F.minCoeff() < 0) || (F.maxCoeff() >= V.rows()))) {
+        spdlog::error("Mesh faces index vertices outside of [0, {})", V.rows());
+        return false;
+    }
+    if ((FT.size() > 0) && ((FT.minCoeff() < 0) || (FT.maxCoeff() >= uv.rows()))) {
+        spdlog::error("Layout faces index vertices outside of [0, {})", uv.rows());
+        return false;
+    }
+    for (const auto& edge : feature_edges) {
+        if ((edge[0] < 0) || (edge[0] >= V.rows()) || (edge[1] < 0) || (edge[1] >= V.rows())) {
+            spdlog::error("Feature edge ({}, {}) is not between mesh vertices", edge[0], edge[1]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Compute quality measures of a seamless parameterization in parallel.
+ *
+ * The feature alignment of an edge is the smaller of its absolute u and v extents, maximized
+ * over the two sides of the edge, so that aligned edges have zero error. Feature edges that
+ * are not mesh edges are only counted. The seam transition
+ * error of a seam edge is the distance between its layout vectors on the two sides, after the
+ * best rotation by a multiple of 90 degrees, relative to the edge layout length. Cones are
+ * counted on the mesh cut along features, with mesh boundaries treated as features. The input
+ * is assumed to satisfy validate_parameterization.
+ *
+ * @param V: mesh vertices
+ * @param F: mesh faces
+ * @param uv: layout vertices
+ * @param FT: layout faces
+ * @param feature_edges: feature edges as vertex index pairs
+ * @return quality report
+ */
+template <typename EdgeList>
+QualityReport compute_quality_report(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& F,
+    const Eigen::MatrixXd& uv,
+    const Eigen::MatrixXi& FT,
+    const EdgeList& feature_edges)
+{
+    ScopedTimer timer("compute quality report", "report");
+    QualityReport report;
+    report.num_vertices = V.rows();
+    report.num_faces = F.rows();
+    HalfedgeConnectivity connectivity = build_halfedge_connectivity(F, V.rows());
+    int num_blocks = get_num_threads();
+
+    // get layout vector of a halfedge in its face
+    auto layout_vector = [&](int h) -> Eigen::Vector2d {
+        int f = h / 3;
+        int i = h % 3;
+        return (uv.row(FT(f, (i + 1) % 3)) - uv.row(FT(f, i))).head<2>().transpose();
+    };
+
+    // find halfedges of feature edges and measure their alignment, counting feature edges that
+    // are not mesh edges separately
+    int num_feature_edges = feature_edges.size();
+    std::vector<Statistic> block_statistics(num_blocks);
+    std::vector<int> feature_halfedges(2 * num_feature_edges, -1);
+    std::vector<int> block_missing(num_blocks, 0);
+    parallel_for_blocks(num_feature_edges, num_blocks, [&](int block, int64_t begin, int64_t end) {
+        for (int64_t eij = begin; eij < end; ++eij) {
+            int vi = feature_edges[eij][0];
+            int vj = feature_edges[eij][1];
+            double error = 0.;
+            for (int k = 0; k < 2; ++k) {
+                int tail = (k == 0) ? vi : vj;
+                int tip = (k == 0) ? vj : vi;
+                for (int l = connectivity.out_offsets[tail]; l < connectivity.out_offsets[tail + 1]; ++l) {
+                    int h = connectivity.out_halfedges[l];
+                    if (connectivity.tip(h) != tip) continue;
+                    feature_halfedges[2 * eij + k] = h;
+                    Eigen::Vector2d d = layout_vector(h);
+                    error = std::max(error, std::min(std::abs(d[0]), std::abs(d[1])));
+                    break;
+                }
+            }
+            if ((feature_halfedges[2 * eij] < 0) && (feature_halfedges[2 * eij + 1] < 0)) {
+                ++block_missing[block];
+            } else {
+                block_statistics[block].add(error);
+            }
+        }
+    });
+    for (int block = 0; block < num_blocks; ++block) {
+        report.feature_alignment.merge(block_statistics[block]);
+        report.num_missing_feature_edges += block_missing[block];
+    }
+
+    // mark corners opposite feature and boundary edges as in the pipeline outputs
+    Eigen::MatrixXi is_feature = Eigen::MatrixXi::Zero(F.rows(), 3);
+    for (int h : feature_halfedges) {
+        if (h >= 0) is_feature(h / 3, (h % 3 + 2) % 3) = 1;
+    }
+    for (int h = 0; h < connectivity.num_halfedges(); ++h) {
+        if (connectivity.is_boundary(h)) is_feature(h / 3, (h % 3 + 2) % 3) = 1;
+    }
+
+    // measure the rotational consistency of layout edges across seams
+    block_statistics.assign(num_blocks, Statistic());
+    parallel_for_blocks(connectivity.num_halfedges(), num_blocks, [&](int block, int64_t begin, int64_t end) {
+        for (int64_t h = begin; h < end; ++h) {
+            int h_opp = connectivity.opposite[h];
+            if (h_opp <= h) continue;
+            int f = h / 3, i = h % 3;
+            int g = h_opp / 3, j = h_opp % 3;
+            if ((FT(f, i) == FT(g, (j + 1) % 3)) && (FT(f, (i + 1) % 3) == FT(g, j))) continue;
+
+            Eigen::Vector2d d = layout_vector(h);
+            Eigen::Vector2d d_opp = -layout_vector(h_opp);
+            double error = std::numeric_limits<double>::infinity();
+            for (int k = 0; k < 4; ++k) {
+                error = std::min(error, (d - d_opp).norm());
+                d = Eigen::Vector2d(-d[1], d[0]);
+            }
+            double length = d.norm();
+            block_statistics[block].add((length > 0.) ? error / length : error);
+        }
+    });
+    for (const auto& statistic : block_statistics) {
+        report.seam_transition.merge(statistic);
+    }
+
+    // compare 3D and layout angles and check for flipped and degenerate faces
+    block_statistics.assign(num_blocks, Statistic());
+    std::vector<int> block_flipped(num_blocks, 0), block_degenerate(num_blocks, 0);
+    parallel_for_blocks(F.rows(), num_blocks, [&](int block, int64_t begin, int64_t end) {
+        double angles[3], uv_angles[3];
+        for (int64_t f = begin; f < end; ++f) {
+            if ((compute_triangle_angles(V, F(f, 0), F(f, 1), F(f, 2), angles)) &&
+                (compute_triangle_angles(uv, FT(f, 0), FT(f, 1), FT(f, 2), uv_angles))) {
+                for (int i = 0; i < 3; ++i) {
+                    block_statistics[block].add(std::abs(angles[i] - uv_angles[i]));
+                }
+            } else {
+                ++block_degenerate[block];
+            }
+
+            Eigen::Vector2d e0 = (uv.row(FT(f, 1)) - uv.row(FT(f, 0))).head<2>().transpose();
+            Eigen::Vector2d e1 = (uv.row(FT(f, 2)) - uv.row(FT(f, 0))).head<2>().transpose();
+            if (e0[0] * e1[1] - e0[1] * e1[0] <= 0.) ++block_flipped[block];
+        }
+    });
+    for (int block = 0; block < num_blocks; ++block) {
+        report.angle_distortion.merge(block_statistics[block]);
+        report.num_flipped_faces += block_flipped[block];
+        report.num_degenerate_faces += block_degenerate[block];
+    }
+
+    // count distinct cones of the mesh cut along features
+    ConeCorners cone_corners = compute_cone_corners(F, uv, FT, is_feature, connectivity);
+    int num_cut_vertices = (F.rows() > 0) ? cone_corners.vertex_indices.maxCoeff() + 1 : 0;
+    std::vector<char> is_counted(num_cut_vertices, false);
+    for (int f = 0; f < F.rows(); ++f) {
+        for (int i = 0; i < 3; ++i) {
+            int v = cone_corners.vertex_indices(f, i);
+            if ((!cone_corners.is_cone(f, i)) || (is_counted[v])) continue;
+            is_counted[v] = true;
+            double flat_angle = (cone_corners.is_boundary[F(f, i)]) ? PI : 2 * PI;
+            ++report.num_cones;
+            if (cone_corners.corner_cone_angles(f, i) < flat_angle) {
+                ++report.num_positive_cones;
+            } else {
+                ++report.num_negative_cones;
+            }
+        }
+    }
+
+    return report;
+}
+
+// escape a string for a quoted csv field
+inline std::string escape_csv(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '"') escaped.push_back('"');
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+/**
+ * @brief Write a quality report as a single json object or as a csv header and row.
+ *
+ * The format is csv if the file has a .csv extension and json otherwise. Nonfinite values, which
+ * can only arise from nonfinite input coordinates, are written as null in json and empty in csv.
+ *
+ * @param filename: path for the report file
+ * @param name: name of the parameterized mesh
+ * @param report: quality report to write
+ * @return true iff the report was written
+ */
+inline bool write_quality_report(
+    const std::string& filename,
+    const std::string& name,
+    const QualityReport& report)
+{
+    std::vector<std::pair<std::string, double>> fields = {
+        {"num_vertices", report.num_vertices},
+        {"num_faces", report.num_faces},
+        {"num_flipped_faces", report.num_flipped_faces},
+        {"num_degenerate_faces", report.num_degenerate_faces},
+        {"num_feature_edges", report.feature_alignment.count},
+        {"num_missing_feature_edges", report.num_missing_feature_edges},
+        {"max_feature_alignment", report.feature_alignment.max},
+        {"mean_feature_alignment", report.feature_alignment.mean()},
+        {"num_seam_edges", report.seam_transition.count},
+        {"max_seam_transition_error", report.seam_transition.max},
+        {"mean_seam_transition_error", report.seam_transition.mean()},
+        {"max_angle_distortion", report.angle_distortion.max},
+        {"mean_angle_distortion", report.angle_distortion.mean()},
+        {"num_cones", report.num_cones},
+        {"num_positive_cones", report.num_positive_cones},
+        {"num_negative_cones", report.num_negative_cones},
+    };
+
+    std::ofstream output_file(filename);
+    if (!output_file) {
+        spdlog::error("Could not open {} for writing", filename);
+        return false;
+    }
+    output_file << std::setprecision(17);
+    auto write_value = [&](double value, const char* nonfinite_value) {
+        if (std::isfinite(value)) {
+            output_file << value;
+        } else {
+            output_file << nonfinite_value;
+        }
+    };
+    if (std::filesystem::path(filename).extension() == ".csv") {
+        output_file << "name";
+        for (const auto& [key, value] : fields) output_file << "," << key;
+        output_file << "\n\"" << escape_csv(name) << "\"";
+        for (const auto& [key, value] : fields) {
+            output_file << ",";
+            write_value(value, "");
+        }
+        output_file << "\n";
+    } else {
+        output_file << "{\n  \"name\": \"" << escape_json(name) << "\"";
+        for (const auto& [key, value] : fields) {
+            output_file << ",\n  \"" << key << "\": ";
+            write_value(value, "null");
+        }
+        output_file << "\n}\n";
+    }
+
+    return static_cast<bool>(output_file);
+}
+
+} // namespace Penner
@@ -49,7 +49,8 @@ inline void add_newton_parameters(
     app.add_option(
         "--solver",
         alg_params.solver,
-        "Solver to use for linear systems");
+        "Solver to use for linear systems")
+        ->capture_default_str();
     app.add_flag(
         "--reset_lambda",
         alg_params.reset_lambda,
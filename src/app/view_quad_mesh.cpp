@@ -2,7 +2,7 @@
 #include "feature/core/viewer.h"
 #include "feature/core/quads.h"
 
-#include <igl/readOBJ.h>
+#include "obj_io.h"
 #include <CLI/CLI.hpp>
 
 using namespace Penner;
@@ -24,7 +24,7 @@ int main(int argc, char* argv[])
     Eigen::MatrixXd V, uv, N;
     Eigen::MatrixXi F, FT, FN;
     spdlog::info("Using mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, uv, N, F, FT, FN);
+    if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) return 1;
 
     view_quad_mesh(V, F);
 }
@@ -7,12 +7,16 @@
 
 #include "util/vf_mesh.h"
 
-#include <igl/readOBJ.h>
+#include "obj_io.h"
+#include "output_bundle.h"
+#include "quality_report.h"
 #include <igl/remove_unreferenced.h>
 #include <CLI/CLI.hpp>
+#ifdef ENABLE_VISUALIZATION
 #include "polyscope/surface_mesh.h"
 #include "polyscope/point_cloud.h"
 #include "polyscope/curve_network.h"
+#endif
 
 using namespace Penner;
 using namespace Penner::Holonomy;
@@ -49,9 +53,13 @@ int main(int argc, char* argv[])
     // Get command line arguments
     CLI::App app{"View a quad mesh"};
     std::string mesh_filename = "";
+    std::string report_filename = "";
+    int num_threads = 0;
 
     // IO Parameters
-    app.add_option("--mesh", mesh_filename, "Mesh filepath")->check(CLI::ExistingFile)->required();
+    app.add_option("--mesh", mesh_filename, "Mesh filepath (obj or output bundle)")->check(CLI::ExistingFile)->required();
+    app.add_option("--report", report_filename, "Write a json (or csv) quality report without opening the viewer");
+    app.add_option("--threads", num_threads, "Number of threads for the quality report (0 for all)");
     CLI11_PARSE(app, argc, argv);
 
     spdlog::set_level(spdlog::level::debug);
@@ -59,11 +67,41 @@ int main(int argc, char* argv[])
     // Get input mesh
     Eigen::MatrixXd V, uv, N;
     Eigen::MatrixXi F, FT, FN;
+    std::vector<VertexEdge> E;
     spdlog::info("Using mesh at {}", mesh_filename);
-    igl::readOBJ(mesh_filename, V, uv, N, F, FT, FN);
+    if (is_output_bundle(mesh_filename)) {
+        RefinedParameterization parameterization;
+        Eigen::MatrixXi is_cone_corner;
+        if (!load_output_bundle(mesh_filename, parameterization, is_cone_corner)) return 1;
+        V = std::move(parameterization.V);
+        F = std::move(parameterization.F);
+        uv = std::move(parameterization.uv);
+        FT = std::move(parameterization.FT);
+        E = std::move(parameterization.feature_edges);
+    } else {
+        if (!load_obj_mesh(mesh_filename, V, uv, N, F, FT, FN)) {
+            spdlog::error("Could not load mesh from {}", mesh_filename);
+            return 1;
+        }
+        E = load_mesh_edges(mesh_filename);
+    }
 
-    std::vector<VertexEdge> E = load_mesh_edges(mesh_filename);
+    // write quality report without viewing
+    if (!report_filename.empty()) {
+        if (!validate_parameterization(V, F, uv, FT, E)) return 1;
+        set_num_threads(num_threads);
+        QualityReport report = compute_quality_report(V, F, uv, FT, E);
+        spdlog::info("Maximum feature alignment: {}", report.feature_alignment.max);
+        if (report.num_missing_feature_edges > 0) {
+            spdlog::warn("{} feature edges are not mesh edges", report.num_missing_feature_edges);
+        }
+        spdlog::info("Maximum seam transition error: {}", report.seam_transition.max);
+        spdlog::info("{} cones and {} flipped faces", report.num_cones, report.num_flipped_faces);
+        std::string name = std::filesystem::path(mesh_filename).stem().string();
+        return (write_quality_report(report_filename, name, report)) ? 0 : 1;
+    }
 
+#ifdef ENABLE_VISUALIZATION
     Eigen::MatrixXi F_is_seam = find_seams(F, FT);
     auto [V_seams, E_seams] = generate_edges(V, F, F_is_seam);
 
@@ -100,5 +138,8 @@ int main(int argc, char* argv[])
     if (show_seams) polyscope::registerCurveNetwork("seams", V_seams, E_seams);
 
     polyscope::show();
-
+#else
+    spdlog::error("Built without visualization, so only --report is supported");
+    return 1;
+#endif
 }